@@ -22,6 +22,7 @@
 
 #include <QAbstractAnimation>
 #include <QEasingCurve>
+#include <QPolygonF>
 
 class QGVMap;
 class QGVProjection;
@@ -29,7 +30,12 @@ class QGVProjection;
 class QGV_LIB_DECL QGVCameraState
 {
 public:
-    explicit QGVCameraState(QGVMap* geoMap, double azimuth, double scale, const QRectF& projRect, bool animation);
+    explicit QGVCameraState(QGVMap* geoMap,
+                            double azimuth,
+                            double scale,
+                            const QRectF& projRect,
+                            bool animation,
+                            const QPolygonF& projPolygon = QPolygonF());
     QGVCameraState(const QGVCameraState& other);
     QGVCameraState(const QGVCameraState&& other);
     QGVCameraState& operator=(const QGVCameraState& other);
@@ -41,6 +47,7 @@ public:
     double scale() const;
     double azimuth() const;
     QRectF projRect() const;
+    QPolygonF projPolygon() const;
     QPointF projCenter() const;
     bool animation() const;
 
@@ -52,6 +59,7 @@ private:
     double mScale;
     double mAzimuth;
     QRectF mProjRect;
+    QPolygonF mProjPolygon;
     bool mAnimation;
 };
 
@@ -98,6 +106,7 @@ protected:
     virtual void onStart();
     virtual void onStop();
     virtual void onProgress(double progress, QGVCameraActions& target) = 0;
+    virtual bool isTargetKnown() const;
 
     static double interpolateScale(double from, double to, double progress);
     static double interpolateAzimuth(double from, double to, double progress);
@@ -122,6 +131,7 @@ public:
 
 private:
     void onProgress(double progress, QGVCameraActions& target) override;
+    bool isTargetKnown() const override;
 
 private:
     QEasingCurve mEasing;
@@ -135,6 +145,7 @@ public:
 private:
     void onStart() override;
     void onProgress(double progress, QGVCameraActions& target) override;
+    bool isTargetKnown() const override;
 
 private:
     double mFlyScale;
@@ -23,6 +23,8 @@
 #include "QGVMap.h"
 #include "QGVMapQGItem.h"
 
+class QGVLayer;
+
 class QGV_LIB_DECL QGVDrawItem : public QGVItem
 {
     Q_OBJECT
@@ -30,19 +32,23 @@ class QGV_LIB_DECL QGVDrawItem : public QGVItem
 
 public:
     QGVDrawItem();
+    ~QGVDrawItem();
 
     void setFlags(QGV::ItemFlags flags);
     void setFlag(QGV::ItemFlag flag, bool enabled = true);
     QGV::ItemFlags getFlags() const;
     bool isFlag(QGV::ItemFlag flag) const;
+    QGV::CameraInterests getCameraInterests() const override;
 
     void refresh();
     void repaint();
+    void repaint(const QRectF& projRect);
     void resetBoundary();
     QTransform effectiveTransform() const;
 
     virtual QPainterPath projShape() const = 0;
     virtual void projPaint(QPainter* painter) = 0;
+    virtual bool projContains(const QPointF& projPos) const;
     virtual QPointF projAnchor() const;
     virtual QTransform projTransform() const;
     virtual QString projTooltip(const QPointF& projPos) const;
@@ -59,9 +65,27 @@ protected:
     void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState) override;
     void onUpdate() override;
     void onClean() override;
+    void flushDeferred(int what) override;
+
+private:
+    friend class QGVLayer;
+    void updateIndex();
+    void leaveIndex();
+    void validateCull();
+    bool isInViewport(const QGVCameraState& camera);
+    bool isCameraChanged(const QGVCameraState& oldState, const QGVCameraState& newState) const;
+    void updateCamera(const QGVCameraState& camera);
+    void setCameraStale(bool stale);
+    double getStaleReach();
+    static QRectF viewportArea(const QGVCameraState& camera);
 
 private:
     QGV::ItemFlags mFlags;
     QScopedPointer<QGVMapQGItem> mQGDrawItem;
     bool mDirty;
+    QGVLayer* mIndexLayer;
+    bool mCameraStale;
+    bool mCullValid;
+    QRectF mCullRect;
+    QPointF mCullAnchor;
 };
@@ -98,9 +98,20 @@ enum class ItemFlag : int
     Transformed = 0x40,
     Clickable = 0x80,
     Movable = 0x100,
+    NoCache = 0x200,
 };
 Q_DECLARE_FLAGS(ItemFlags, ItemFlag)
 
+enum class CameraInterest : int
+{
+    Scale = 0x1,
+    Azimuth = 0x2,
+    Area = 0x4,
+    Target = 0x8,
+    All = 0xF,
+};
+Q_DECLARE_FLAGS(CameraInterests, CameraInterest)
+
 class QGV_LIB_DECL GeoPos
 {
 public:
@@ -165,6 +176,8 @@ public:
     GeoTilePos& operator=(const GeoTilePos&& other);
 
     bool operator<(const GeoTilePos& other) const;
+    bool operator==(const GeoTilePos& other) const;
+    bool operator!=(const GeoTilePos& other) const;
 
     int zoom() const;
     QPoint pos() const;
@@ -182,6 +195,12 @@ private:
     QPoint mPos;
 };
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+QGV_LIB_DECL size_t qHash(const GeoTilePos& key, size_t seed = 0);
+#else
+QGV_LIB_DECL uint qHash(const GeoTilePos& key, uint seed = 0);
+#endif
+
 QGV_LIB_DECL void setNetworkManager(QNetworkAccessManager* manager);
 QGV_LIB_DECL QNetworkAccessManager* getNetworkManager();
 
@@ -206,6 +225,7 @@ Q_DECLARE_METATYPE(QGV::GeoRect)
 Q_DECLARE_METATYPE(QGV::GeoTilePos)
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(QGV::ItemFlags)
+Q_DECLARE_OPERATORS_FOR_FLAGS(QGV::CameraInterests)
 
 #define qgvDebug                                                                                                       \
     if (QGV::isPrintDebug())                                                                                           \
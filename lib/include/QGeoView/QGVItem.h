@@ -39,7 +39,10 @@ public:
     virtual QGVMap* getMap() const;
 
     void addItem(QGVItem* item);
+    void addItems(const QList<QGVItem*>& items);
     void removeItem(QGVItem* item);
+    void removeItems(const QList<QGVItem*>& items);
+    QList<QGVItem*> takeItems();
     void deleteItems();
     int countItems() const;
     QGVItem* getItem(int index) const;
@@ -62,6 +65,9 @@ public:
     void setVisible(bool visible);
     bool isVisible() const;
 
+    void setCameraInterests(QGV::CameraInterests interests);
+    virtual QGV::CameraInterests getCameraInterests() const;
+
     void show();
     void hide();
 
@@ -73,16 +79,53 @@ public:
 
     virtual void onProjection(QGVMap* geoMap);
     virtual void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState);
+    virtual void onCameraTarget(const QGVCameraActions& target);
     virtual void onUpdate();
     virtual void onClean();
 
+protected:
+    enum Deferred
+    {
+        DeferUpdate = 0x1,
+        DeferBoundary = 0x2,
+        DeferRefresh = 0x4,
+        DeferAll = 0x7,
+    };
+
+    bool defer(int what);
+    void undefer(int what);
+    bool isDeferred(int what) const;
+    virtual void flushDeferred(int what);
+    void updateCameraSubscription();
+
 private:
+    friend class QGVMap;
     Q_DISABLE_COPY(QGVItem)
+    void attachChild(QGVItem* item);
+    void detachChild(QGVItem* item);
+    void compactChildren() const;
+    void calculateEffective() const;
+    void invalidateEffective();
+    template<typename Visitor>
+    void forEachChild(Visitor visit);
+
+private:
     QGVItem* mParent;
     qint16 mZValue;
     double mOpacity;
     bool mVisible;
+    mutable bool mEffectiveValid;
+    mutable bool mEffectiveVisible;
+    mutable double mEffectiveZValue;
+    mutable double mEffectiveZRange;
+    mutable double mEffectiveOpacity;
     bool mSelectable;
     bool mSelected;
-    QList<QGVItem*> mChildrens;
+    QGV::CameraInterests mCameraInterests;
+    QGVMap* mCameraMap;
+    int mDeferred;
+    int mParentSlot;
+    int mChildVisits;
+    mutable int mChildHoles;
+    mutable QVector<QGVItem*> mChildrens;
 };
@@ -19,7 +19,16 @@
 #pragma once
 
 #include "QGVItem.h"
+#include "QGVSpatialIndex.h"
 
+#include <QSet>
+
+class QGVDrawItem;
+
+/*!
+ * Group of items shown on map.
+ * Draw items added directly to layer are kept in spatial index, so geo queries are answered without scene.
+ */
 class QGV_LIB_DECL QGVLayer : public QGVItem
 {
     Q_OBJECT
@@ -27,13 +36,41 @@ class QGV_LIB_DECL QGVLayer : public QGVItem
     Q_PROPERTY(QString description READ getDescription WRITE setDescription)
 
 public:
+    QGVLayer();
+    ~QGVLayer();
+
     void setName(const QString& name);
     QString getName() const;
 
     void setDescription(const QString& description);
     QString getDescription() const;
 
+    QList<QGVDrawItem*> search(const QRectF& projRect) const;
+    QList<QGVDrawItem*> search(const QGV::GeoRect& geoRect) const;
+    QList<QGVDrawItem*> search(const QGV::GeoPos& geoPos, double radiusMeters) const;
+    QList<QGVDrawItem*> searchNearest(const QGV::GeoPos& geoPos, int count) const;
+
+    QGV::CameraInterests getCameraInterests() const override;
+
+protected:
+    void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState) override;
+    void flushIndex() const;
+    virtual void onIndexChanged();
+    virtual void onItemIndexed(QGVDrawItem* item, const QRectF& projRect);
+    virtual void onItemUnindexed(QGVDrawItem* item);
+
+private:
+    friend class QGVDrawItem;
+    void indexItem(QGVDrawItem* item);
+    void unindexItem(QGVDrawItem* item);
+    void addStaleItem(QGVDrawItem* item, double reach);
+    void removeStaleItem(QGVDrawItem* item);
+
 private:
     QString mName;
     QString mDescription;
+    mutable QGVSpatialIndex mIndex;
+    mutable QSet<QGVDrawItem*> mIndexDirty;
+    QSet<QGVDrawItem*> mStaleItems;
+    double mStaleReach;
 };
@@ -0,0 +1,111 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayer.h"
+
+#include <QColor>
+#include <QHash>
+#include <QPen>
+#include <QVector>
+
+/*!
+ * Layer for large number of simple primitives (rectangles and ellipses) drawn by single scene item.
+ * Primitives are kept in flat arrays and addressed by index, so picking, selection and tooltips work per primitive
+ * without separate draw item for every one of them. Primitive selection is kept by layer, separately from map
+ * selection. Projected primitives are indexed by uniform grid, so picking, range queries and painting visit only
+ * primitives near requested area.
+ */
+class QGV_LIB_DECL QGVLayerBatch : public QGVLayer
+{
+    Q_OBJECT
+
+public:
+    enum class Shape
+    {
+        Rectangle,
+        Ellipse,
+    };
+
+    QGVLayerBatch();
+    ~QGVLayerBatch();
+
+    int addPrimitive(Shape shape, const QGV::GeoRect& geoRect, const QColor& color);
+    void reservePrimitives(int count);
+    void clearPrimitives();
+    int countPrimitives() const;
+
+    Shape getPrimitiveShape(int index) const;
+    void setPrimitiveRect(int index, const QGV::GeoRect& geoRect);
+    QGV::GeoRect getPrimitiveRect(int index) const;
+    void setPrimitiveColor(int index, const QColor& color);
+    QColor getPrimitiveColor(int index) const;
+    void setPrimitiveTooltip(int index, const QString& text);
+    QString getPrimitiveTooltip(int index) const;
+
+    void setPrimitiveSelected(int index, bool selected);
+    bool isPrimitiveSelected(int index) const;
+    QVector<int> getSelectedPrimitives() const;
+    void unselectPrimitives();
+
+    void setPen(const QPen& pen);
+    QPen getPen() const;
+
+    int primitiveAt(const QPointF& projPos) const;
+    QVector<int> primitivesIn(const QRectF& projRect) const;
+
+Q_SIGNALS:
+    void primitiveClicked(int index);
+    void primitiveDoubleClicked(int index);
+
+protected:
+    void onProjection(QGVMap* geoMap) override;
+
+private:
+    class BatchItem;
+
+    bool isPrimitiveAt(int index, const QPointF& projPos) const;
+    void projectPrimitive(int index);
+    void findPrimitives(const QRectF& projRect, QVector<int>& result) const;
+    void rebuildGrid() const;
+    QRect gridCells(const QRectF& projRect) const;
+    void indexPrimitive(int index) const;
+    void unindexPrimitive(int index, const QRectF& projRect) const;
+    void paintPrimitives(QPainter* painter);
+    void clickPrimitive(const QPointF& projPos);
+
+private:
+    BatchItem* mItem;
+    QVector<QGV::GeoRect> mGeoRects;
+    QVector<QRectF> mProjRects;
+    QVector<QRgb> mColors;
+    QVector<quint8> mShapes;
+    QVector<bool> mSelected;
+    int mSelectedCount;
+    QHash<int, QString> mTooltips;
+    QRectF mProjBoundary;
+    QPen mPen;
+    mutable bool mGridDirty;
+    mutable QRectF mGridRect;
+    mutable QSizeF mCellSize;
+    mutable int mGridCols;
+    mutable int mGridRows;
+    mutable QVector<QVector<int>> mGridCells;
+    QVector<int> mVisible;
+};
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "QGVLayerTilesOnline.h"
+#include "QGVUrlTemplate.h"
 
 class QGV_LIB_DECL QGVLayerBing : public QGVLayerTilesOnline
 {
@@ -27,7 +28,7 @@ class QGV_LIB_DECL QGVLayerBing : public QGVLayerTilesOnline
 public:
     explicit QGVLayerBing(QGV::TilesType type = QGV::TilesType::Schema,
                           QLocale locale = QLocale(),
-                          int serverNumber = 0);
+                          int serverNumber = -1);
 
     void setType(QGV::TilesType type);
     void setLocale(const QLocale& locale);
@@ -37,6 +38,7 @@ public:
 
 private:
     void createName();
+    void createTemplate();
     int minZoomlevel() const override;
     int maxZoomlevel() const override;
     QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const override;
@@ -45,4 +47,5 @@ private:
     QGV::TilesType mType;
     QLocale mLocale;
     int mServerNumber;
+    QGVUrlTemplate mTemplate;
 };
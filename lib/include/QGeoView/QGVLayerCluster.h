@@ -0,0 +1,104 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayer.h"
+
+#include <QColor>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+
+/*!
+ * Layer which groups its point items (QGVPoint, QGVIcon or any draw item) into clusters.
+ * Items are counted in grid cells of every zoom level, so moving of one item updates only its cells. On current zoom
+ * items of cells with at least minimum cluster size are hidden and one cluster symbol with count is drawn instead.
+ * Visibility set by user is kept aside while item is clustered and restored when cluster is split or item leaves
+ * layer, so items hidden by user are never shown by layer.
+ */
+class QGV_LIB_DECL QGVLayerCluster : public QGVLayer
+{
+    Q_OBJECT
+
+public:
+    QGVLayerCluster();
+    ~QGVLayerCluster();
+
+    void setClusterCellSize(int pixels);
+    int getClusterCellSize() const;
+    void setClusterMaxZoom(int zoom);
+    int getClusterMaxZoom() const;
+    void setMinClusterSize(int count);
+    int getMinClusterSize() const;
+    void setClusterColor(const QColor& color);
+    QColor getClusterColor() const;
+
+    int getClusterZoom() const;
+    int countClusters() const;
+    bool isClustered(QGVDrawItem* item) const;
+    QList<QGVDrawItem*> getClusterItems(const QPointF& projPos) const;
+
+Q_SIGNALS:
+    void clusterClicked(const QList<QGVDrawItem*>& items);
+
+protected:
+    void onProjection(QGVMap* geoMap) override;
+    void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState) override;
+    void onIndexChanged() override;
+    void onItemIndexed(QGVDrawItem* item, const QRectF& projRect) override;
+    void onItemUnindexed(QGVDrawItem* item) override;
+
+private:
+    class ClusterItem;
+
+    struct Cell
+    {
+        int count = 0;
+        double sumX = 0;
+        double sumY = 0;
+    };
+
+    void rebuildLevels();
+    void updateClusters();
+    void addPosition(const QPointF& projPos, int delta);
+    void applyItem(QGVDrawItem* item, const QPointF& projPos);
+    int scaleToZoom(double scale) const;
+    quint64 cellKey(int zoom, const QPointF& projPos) const;
+    QRectF cellRect(int zoom, quint64 key) const;
+    bool isClusterZoom() const;
+    bool findCluster(const QPointF& projPos, quint64& key) const;
+    void paintClusters(QPainter* painter);
+
+private:
+    ClusterItem* mItem;
+    QVector<QHash<quint64, Cell>> mLevels;
+    QVector<double> mCellSizes;
+    QPointF mOrigin;
+    QHash<QGVDrawItem*, QPointF> mPositions;
+    QHash<QGVDrawItem*, bool> mClustered;
+    QSet<quint64> mDirtyCells;
+    bool mFullApply;
+    int mCurZoom;
+    QTimer mUpdateTimer;
+
+    int mCellSize;
+    int mMaxZoom;
+    int mMinClusterSize;
+    QColor mColor;
+};
@@ -19,13 +19,14 @@
 #pragma once
 
 #include "QGVLayerTilesOnline.h"
+#include "QGVUrlTemplate.h"
 
 class QGV_LIB_DECL QGVLayerOSM : public QGVLayerTilesOnline
 {
     Q_OBJECT
 
 public:
-    explicit QGVLayerOSM(int serverNumber = 0);
+    explicit QGVLayerOSM(int serverNumber = -1);
     explicit QGVLayerOSM(const QString& url);
 
     void setUrl(const QString& url);
@@ -34,8 +35,9 @@ public:
 private:
     int minZoomlevel() const override;
     int maxZoomlevel() const override;
+    void onTileSize(int tileSize) override;
     QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const override;
 
 private:
-    QString mUrl;
+    QGVUrlTemplate mTemplate;
 };
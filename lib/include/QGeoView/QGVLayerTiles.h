@@ -19,8 +19,17 @@
 #pragma once
 
 #include "QGVLayer.h"
+#include "QGVTileMetrics.h"
+#include "QGVTileMosaic.h"
+#include "QGVTilePyramid.h"
+#include "QGVTileStore.h"
 
+#include <QCache>
 #include <QElapsedTimer>
+#include <QImage>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
 
 class QGV_LIB_DECL QGVLayerTiles : public QGVLayer
 {
@@ -35,37 +44,123 @@ public:
     void setVisibleZoomLayersBelowCurrent(size_t value);
     void setVisibleZoomLayersAboveCurrent(size_t value);
     void setCameraUpdatesDuringAnimation(bool value);
+    void setTileCacheSize(size_t bytes);
+    void setTileMemoryBudget(size_t bytes);
+    size_t getTileMemoryBudget() const;
+    size_t getTileMemoryUsage() const;
+    void setMosaicRendering(bool enabled);
+    bool isMosaicRendering() const;
+    void setOverzoomFallback(bool enabled);
+    bool isOverzoomFallback() const;
+    void setTileSize(int pixels);
+    int getTileSize() const;
+    void setDevicePixelRatio(qreal ratio);
+    qreal getDevicePixelRatio() const;
+
+    quint64 getTileCacheHits() const;
+    quint64 getTileCacheMisses() const;
+    void clearTileCache();
+
+    const QGVTileMetrics& getMetrics() const;
+    void resetMetrics();
+    void setMetricsInterval(int msec);
+    int getMetricsInterval() const;
+
+    void setTileStore(QGVTileStore* store);
+    QGVTileStore* getTileStore() const;
+    void setLayerId(const QString& layerId);
+    QString getLayerId() const;
+
+Q_SIGNALS:
+    void metricsUpdated(const QGVTileMetrics& metrics);
 
 protected:
     void onProjection(QGVMap* geoMap) override;
     void onCamera(const QGVCameraState& oldState, const QGVCameraState& newState) override;
+    void onCameraTarget(const QGVCameraActions& target) override;
     void onUpdate() override;
     void onClean() override;
     void onTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    void onTileFailed(const QGV::GeoTilePos& tilePos);
+    virtual void onTileSize(int tileSize);
 
     virtual int minZoomlevel() const = 0;
     virtual int maxZoomlevel() const = 0;
     virtual int scaleToZoom(double scale) const;
     virtual void request(const QGV::GeoTilePos& tilePos) = 0;
     virtual void cancel(const QGV::GeoTilePos& tilePos) = 0;
+    virtual void reprioritize();
+    void requestFailed();
+
+    qreal getTilePriority(const QGV::GeoTilePos& tilePos) const;
+    QGVTilePyramid::TileState getTileState(const QGV::GeoTilePos& tilePos) const;
+    QString getTileSetId() const;
+    QGVTileMetrics& metrics();
 
 private:
     void processCamera();
+    void scheduleCamera();
+    QRect tileFootprint(int zoom, const QPolygonF& areaProjPolygon, int margin, QVector<QPair<int, int>>& spans) const;
+    QPointF projToTile(const QPointF& projPos) const;
+    bool isTileActive(const QGV::GeoTilePos& tilePos) const;
+    void trackViewport();
+    void checkViewportComplete(const QGV::GeoTilePos& tilePos);
+    void prefetch(const QGVCameraActions& target);
     void removeAllAbove(const QGV::GeoTilePos& tilePos);
     void removeWhenCovered(const QGV::GeoTilePos& tilePos);
     void removeForPerfomance(const QGV::GeoTilePos& tilePos);
     void addTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
     void removeTile(const QGV::GeoTilePos& tilePos);
+    void removeAllTiles();
+    void releaseTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    void enforceMemoryBudget();
+    qreal getEvictionCost(const QGV::GeoTilePos& tilePos, qint64 lastVisible, qint64 now) const;
+    QRectF tileViewRect(const QGV::GeoTilePos& tilePos) const;
+    QGVTileMosaic* getMosaic(int zoom);
+    void addFallback(const QGV::GeoTilePos& tilePos);
+    void removeFallback(const QGV::GeoTilePos& tilePos);
+    QImage findAncestorImage(const QGV::GeoTilePos& tilePos);
+    QImage tileImage(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj) const;
+    void cacheTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    QGVDrawItem* takeCachedTile(const QGV::GeoTilePos& tilePos);
     bool isTileExists(const QGV::GeoTilePos& tilePos) const;
     bool isTileFinished(const QGV::GeoTilePos& tilePos) const;
-    QList<QGV::GeoTilePos> existingTiles(int zoom) const;
 
 private:
     int mCurZoom;
     QRect mCurRect;
-    QMap<int, QMap<QGV::GeoTilePos, QGVDrawItem*>> mIndex;
+    QVector<QPair<int, int>> mCurSpans;
+    QRect mPrevRect;
+    QVector<QPair<int, int>> mPrevSpans;
+    QRectF mCurView;
+    QPointF mTileOrigin;
+    QPointF mTileStep;
+    QVector<QPair<qreal, QGV::GeoTilePos>> mMissing;
+    QGVTilePyramid mIndex;
+    QVector<QGV::GeoTilePos> mScratch;
+    QSet<QGV::GeoTilePos> mPrefetch;
+    QPointF mPrefetchCenter;
+    QMap<int, QGVTileMosaic*> mMosaics;
+    QHash<QGV::GeoTilePos, QGVDrawItem*> mFallback;
 
     QElapsedTimer mLastAnimation;
+    bool mCameraScheduled;
+    QPointer<QGVTileStore> mTileStore;
+    QString mLayerId;
+    QCache<QGV::GeoTilePos, QImage> mTileCache;
+    QGVTileMetrics mMetrics;
+
+    struct TileUsage
+    {
+        size_t bytes;
+        qint64 lastVisible;
+    };
+    QHash<QGV::GeoTilePos, TileUsage> mUsage;
+    size_t mUsageBytes;
+    QElapsedTimer mUsageClock;
+    QTimer mMetricsTimer;
+    QElapsedTimer mViewportTimer;
+    QSet<QGV::GeoTilePos> mViewportPending;
 
     struct
     {
@@ -75,5 +170,11 @@ private:
         bool CameraUpdatesDuringAnimation = true;
         size_t VisibleZoomLayersBelowCurrent = 10;
         size_t VisibleZoomLayersAboveCurrent = 10;
+        size_t TileCacheSize = 64 * 1024 * 1024;
+        size_t TileMemoryBudget = 256 * 1024 * 1024;
+        bool MosaicRendering = false;
+        bool OverzoomFallback = false;
+        int TileSize = 256;
+        qreal DevicePixelRatio = 1;
     } mPerfomanceProfile;
 };
@@ -19,25 +19,89 @@
 #pragma once
 
 #include "QGVLayerTiles.h"
+#include "QGVTileService.h"
 
+#include <QElapsedTimer>
+#include <QImage>
 #include <QNetworkReply>
 
-class QGV_LIB_DECL QGVLayerTilesOnline : public QGVLayerTiles
+class QGV_LIB_DECL QGVLayerTilesOnline
+    : public QGVLayerTiles
+    , private QGVTileService::Subscriber
 {
     Q_OBJECT
 
 public:
+    QGVLayerTilesOnline();
     ~QGVLayerTilesOnline();
 
+    void setMaxRequestsInFlight(int value);
+    int getMaxRequestsInFlight() const;
+    int countQueuedRequests() const;
+    void setMaxRetries(int value);
+    int getMaxRetries() const;
+
 protected:
     virtual QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const = 0;
 
 private:
     void request(const QGV::GeoTilePos& tilePos) override;
+    void requestNetwork(const QGV::GeoTilePos& tilePos);
+    void onStoreLoaded(const QGV::GeoTilePos& tilePos, const QByteArray& rawImage);
     void cancel(const QGV::GeoTilePos& tilePos) override;
-    void onReplyFinished(QNetworkReply* reply, const QGV::GeoTilePos& tilePos);
+    void reprioritize() override;
+    void enqueue(const QGV::GeoTilePos& tilePos);
+    void dispatch();
+    void scheduleDispatch();
+    void send(const QGV::GeoTilePos& tilePos);
+    void fail(const QGV::GeoTilePos& tilePos, bool retryable);
+    void retry(const QGV::GeoTilePos& tilePos, quint64 token);
+    bool isHostAvailable(const QString& host, const QString& key);
+    void cancelProbe(const QString& key);
+    void onHostResult(const QString& host, bool reachable);
+    void onTileReady(const QString& key,
+                     const QByteArray& rawData,
+                     const QImage& image,
+                     qint64 networkMs,
+                     qint64 decodeMs) override;
+    void onTileFetchFailed(const QString& key,
+                           QNetworkReply::NetworkError error,
+                           const QString& errorString) override;
+    void decode(const QGV::GeoTilePos& tilePos, const QString& source, const QByteArray& rawImage);
     void removeReply(const QGV::GeoTilePos& tilePos);
+    void removeDecode(const QGV::GeoTilePos& tilePos);
 
 private:
-    QMap<QGV::GeoTilePos, QNetworkReply*> mRequest;
+    struct QueuedTile
+    {
+        qreal priority;
+        QGV::GeoTilePos tilePos;
+    };
+
+    struct TileFailure
+    {
+        int attempts;
+        qint64 blockedUntil;
+    };
+
+    struct HostCircuit
+    {
+        int failures = 0;
+        qint64 openUntil = 0;
+        QString probeKey;
+    };
+
+    int mMaxRequestsInFlight;
+    int mMaxRetries;
+    bool mDispatchScheduled;
+    quint64 mRetryToken;
+    QElapsedTimer mClock;
+    QVector<QueuedTile> mQueue;
+    QHash<QGV::GeoTilePos, TileFailure> mFailures;
+    QHash<QGV::GeoTilePos, quint64> mRetry;
+    QHash<QString, HostCircuit> mHosts;
+    QHash<QGV::GeoTilePos, QString> mRequest;
+    QHash<QGV::GeoTilePos, QString> mDecode;
+    QSet<QGV::GeoTilePos> mStoreLoads;
+    QHash<QString, QGV::GeoTilePos> mKeys;
 };
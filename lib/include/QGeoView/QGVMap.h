@@ -19,6 +19,7 @@
 #pragma once
 
 #include <QMimeData>
+#include <QPointer>
 #include <QWidget>
 
 #include "QGVCamera.h"
@@ -36,10 +37,32 @@ class QGV_LIB_DECL QGVMap : public QWidget
     Q_OBJECT
 
 public:
+    /*!
+     * Keeps map in update transaction while in scope.
+     */
+    class UpdateGuard
+    {
+    public:
+        explicit UpdateGuard(QGVMap* geoMap)
+            : mGeoMap(geoMap)
+        {
+            mGeoMap->beginUpdate();
+        }
+        ~UpdateGuard()
+        {
+            mGeoMap->endUpdate();
+        }
+
+    private:
+        Q_DISABLE_COPY(UpdateGuard)
+        QGVMap* mGeoMap;
+    };
+
     explicit QGVMap(QWidget* parent = 0);
     ~QGVMap();
 
     const QGVCameraState getCamera() const;
+    QGV::MapState getState() const;
     void cameraTo(const QGVCameraActions& actions, bool animation = false);
     void flyTo(const QGVCameraActions& actions);
 
@@ -81,12 +104,17 @@ public:
     QPointF mapToProj(QPoint pos);
     QPoint mapFromProj(QPointF projPos);
 
+    void beginUpdate();
+    void endUpdate();
+    bool isUpdating() const;
+
     void refreshMap();
     void refreshProjection();
     void anchoreWidgets();
 
     virtual void onMapState(QGV::MapState state);
     virtual void onMapCamera(const QGVCameraState& oldState, const QGVCameraState& newState);
+    virtual void onMapCameraTarget(const QGVCameraActions& target);
 
 protected:
     void mouseMoveEvent(QMouseEvent* event) override;
@@ -109,12 +137,21 @@ Q_SIGNALS:
     void dragEnterOnMap(QGV::GeoPos pos, const QMimeData* data);
     void dragMoveOnMap(QGV::GeoPos pos, const QMimeData* data);
 
+private:
+    friend class QGVItem;
+    void deferItem(QGVItem* item);
+    void subscribeCamera(QGVItem* item);
+    void unsubscribeCamera(QGVItem* item);
+
 private:
     QScopedPointer<QGVProjection> mProjection;
     QScopedPointer<QGVMapQGView> mQGView;
     QScopedPointer<QGVItem> mRootItem;
     QList<QGVWidget*> mWidgets;
     QSet<QGVItem*> mSelections;
+    int mUpdateLevel;
+    QVector<QPointer<QGVItem>> mDeferredItems;
+    QSet<QGVItem*> mCameraItems;
     void handleDropDataOnQGVMapQGView(QPointF position, const QMimeData* dropData);
     void handleDragEnterDataOnQGVMapQGView(QPointF position, const QMimeData* dragEnterData);
     void handleDragMoveDataOnQGVMapQGView(QPointF position, const QMimeData* dragMoveData);
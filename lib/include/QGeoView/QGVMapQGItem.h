@@ -37,6 +37,7 @@ private:
     QRectF boundingRect() const override final;
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0) override final;
     QPainterPath shape() const override final;
+    bool contains(const QPointF& point) const override final;
     void hoverEnterEvent(QGraphicsSceneHoverEvent* event) override final;
     void hoverLeaveEvent(QGraphicsSceneHoverEvent* event) override final;
 
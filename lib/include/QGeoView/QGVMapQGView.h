@@ -30,6 +30,7 @@
 #include <QGraphicsView>
 #include <QMenu>
 #include <QMimeData>
+#include <QTimer>
 
 class QGVMap;
 
@@ -44,6 +45,7 @@ public:
     QGV::MouseActions getMouseActions() const;
 
     QGVCameraState getCamera() const;
+    QGV::MapState getState() const;
     void cameraTo(const QGVCameraActions& actions, bool animation);
     double getMinScale() const;
     double getMaxScale() const;
@@ -65,6 +67,8 @@ private:
     void blockCameraUpdate();
     void unblockCameraUpdate();
     void applyCameraUpdate(const QGVCameraState& oldState);
+    void flushCameraUpdate();
+    int frameInterval() const;
 
     void showTooltip(QHelpEvent* helpEvent);
     void zoomByWheel(QWheelEvent* event);
@@ -108,6 +112,8 @@ private:
     QGV::MouseActions mMouseActions;
     QRect mViewRect;
     QGV::MapState mState;
+    QScopedPointer<QGVCameraState> mPendingCamera;
+    QTimer mCameraTimer;
     QRect mWheelMouseArea;
     QPointF mWheelProjAnchor;
     double mWheelBestFactor;
@@ -0,0 +1,80 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class QGVDrawItem;
+
+/*!
+ * R-tree of item bounding rectangles in projection coordinates.
+ * Leaf of every item is remembered, so moved or removed items are updated without search from the root.
+ */
+class QGV_LIB_DECL QGVSpatialIndex
+{
+public:
+    QGVSpatialIndex();
+    ~QGVSpatialIndex();
+
+    void clear();
+    int count() const;
+    bool contains(QGVDrawItem* item) const;
+    QRectF rect(QGVDrawItem* item) const;
+
+    void insert(QGVDrawItem* item, const QRectF& projRect);
+    void remove(QGVDrawItem* item);
+
+    void search(const QRectF& projRect, QList<QGVDrawItem*>& result) const;
+    void nearest(const QPointF& projPos, int count, QList<QGVDrawItem*>& result) const;
+
+private:
+    struct Node;
+    struct Entry
+    {
+        QRectF rect;
+        Node* child;
+        QGVDrawItem* item;
+    };
+    struct Node
+    {
+        Node* parent = nullptr;
+        bool leaf = true;
+        QVector<Entry> entries;
+    };
+
+    Q_DISABLE_COPY(QGVSpatialIndex)
+    Node* chooseLeaf(const QRectF& projRect) const;
+    void insertEntry(const Entry& entry);
+    void adjustTree(Node* node);
+    Node* split(Node* node);
+    void condenseTree(Node* node);
+    void collectEntries(Node* node, QVector<Entry>& result);
+    void deleteNode(Node* node);
+    void setEntryParent(Node* node, const Entry& entry);
+    static void refreshEntry(Node* parent, const Node* child);
+    static QRectF bounds(const Node* node);
+
+private:
+    Node* mRoot;
+    QHash<QGVDrawItem*, Node*> mLeafs;
+};
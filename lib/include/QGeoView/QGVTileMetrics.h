@@ -0,0 +1,87 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QVector>
+
+/*!
+ * Counters and timing histograms of tile pipeline.
+ * Histogram values are milliseconds, collected into power of two buckets, so percentiles are approximate (upper
+ * bound of bucket, but never above maximal sample).
+ */
+class QGV_LIB_DECL QGVTileMetrics
+{
+public:
+    enum class Counter
+    {
+        Requested,
+        Cancelled,
+        Failed,
+        Retried,
+        Loaded,
+        CacheHits,
+        CacheMisses,
+        BytesDownloaded,
+    };
+
+    enum class Timing
+    {
+        NetworkLatency,
+        DecodeTime,
+        ViewportComplete,
+    };
+
+    class QGV_LIB_DECL Histogram
+    {
+    public:
+        Histogram();
+
+        void addSample(qint64 value);
+        void clear();
+
+        quint64 getCount() const;
+        qint64 getMin() const;
+        qint64 getMax() const;
+        double getMean() const;
+        qint64 getPercentile(double percent) const;
+
+    private:
+        quint64 mCount;
+        qint64 mTotal;
+        qint64 mMin;
+        qint64 mMax;
+        QVector<quint64> mBuckets;
+    };
+
+    QGVTileMetrics();
+
+    void clear();
+
+    void addCounter(Counter counter, quint64 value = 1);
+    quint64 getCounter(Counter counter) const;
+
+    void addSample(Timing timing, qint64 value);
+    const Histogram& getHistogram(Timing timing) const;
+
+private:
+    QVector<quint64> mCounters;
+    QVector<Histogram> mHistograms;
+};
@@ -0,0 +1,66 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVDrawItem.h"
+
+#include <QHash>
+#include <QImage>
+
+/*!
+ * Single draw item for all tiles of one zoom level.
+ * Tiles are kept as cells of sparse grid and painted directly from their images, so mosaic has no item cache and
+ * only changed cells are repainted.
+ */
+class QGV_LIB_DECL QGVTileMosaic : public QGVDrawItem
+{
+    Q_OBJECT
+
+public:
+    explicit QGVTileMosaic(int zoom);
+
+    int getZoom() const;
+    int countTiles() const;
+    bool isEmpty() const;
+
+    bool containsTile(const QGV::GeoTilePos& tilePos) const;
+    QImage getTile(const QGV::GeoTilePos& tilePos) const;
+    void setTile(const QGV::GeoTilePos& tilePos, const QImage& image);
+    void removeTile(const QGV::GeoTilePos& tilePos);
+
+protected:
+    void onProjection(QGVMap* geoMap) override;
+    QPainterPath projShape() const override;
+    void projPaint(QPainter* painter) override;
+
+private:
+    struct Cell
+    {
+        QRectF projRect;
+        QImage image;
+    };
+
+    void calculateGeometry();
+    QRectF cellProjRect(const QGV::GeoTilePos& tilePos) const;
+
+private:
+    int mZoom;
+    QRectF mProjRect;
+    QHash<QGV::GeoTilePos, Cell> mCells;
+};
@@ -0,0 +1,177 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QHash>
+#include <QVector>
+
+class QGVDrawItem;
+
+/*!
+ * Quadtree index of tiles.
+ * Every tile is linked with its parent (zoom - 1) and its four children (zoom + 1), so ancestors and descendants
+ * of tile are reachable directly. Intermediate nodes are kept only while they have tiles below.
+ */
+class QGV_LIB_DECL QGVTilePyramid
+{
+public:
+    enum class TileState
+    {
+        Missing,
+        Pending,
+        Failed,
+        Loaded,
+    };
+
+    struct Node
+    {
+        QGV::GeoTilePos pos;
+        QGVDrawItem* item = nullptr;
+        bool present = false;
+        bool failed = false;
+        int presentBelow = 0;
+        Node* parent = nullptr;
+        Node* children[4] = {};
+    };
+
+    QGVTilePyramid();
+    ~QGVTilePyramid();
+
+    void clear();
+    bool contains(const QGV::GeoTilePos& tilePos) const;
+    QGVDrawItem* item(const QGV::GeoTilePos& tilePos) const;
+    TileState state(const QGV::GeoTilePos& tilePos) const;
+    const Node* node(const QGV::GeoTilePos& tilePos) const;
+    int count(int zoom) const;
+
+    void insert(const QGV::GeoTilePos& tilePos, QGVDrawItem* item);
+    QGVDrawItem* take(const QGV::GeoTilePos& tilePos);
+    void setFailed(const QGV::GeoTilePos& tilePos);
+
+    void collect(QVector<QGV::GeoTilePos>& result) const;
+    void collect(int zoom, QVector<QGV::GeoTilePos>& result) const;
+    void collectFailed(int zoom, QVector<QGV::GeoTilePos>& result) const;
+
+    template<typename Visitor>
+    void forEachAncestor(const QGV::GeoTilePos& tilePos, Visitor visit) const;
+    template<typename Visitor>
+    void forEachDescendant(const QGV::GeoTilePos& tilePos, int toZoom, Visitor visit) const;
+    template<typename Visitor>
+    void takeDescendants(const QGV::GeoTilePos& tilePos, Visitor visit);
+
+private:
+    Q_DISABLE_COPY(QGVTilePyramid)
+    Node* findNode(const QGV::GeoTilePos& tilePos) const;
+    Node* ensureNode(const QGV::GeoTilePos& tilePos);
+    void adjustPresentBelow(Node* node, int delta);
+    void prune(Node* node);
+    void unlink(Node* node);
+    void unlinkSubtree(Node* node);
+    template<typename Visitor>
+    void visitSubtree(const Node* node, int toZoom, Visitor& visit) const;
+    template<typename Visitor>
+    void takeSubtree(Node* node, Visitor& visit);
+
+private:
+    QVector<QHash<QGV::GeoTilePos, Node*>> mLevels;
+};
+
+template<typename Visitor>
+void QGVTilePyramid::forEachAncestor(const QGV::GeoTilePos& tilePos, Visitor visit) const
+{
+    const Node* node = findNode(tilePos);
+    if (node == nullptr) {
+        return;
+    }
+    for (const Node* parent = node->parent; parent != nullptr;) {
+        const Node* next = parent->parent;
+        if (parent->present) {
+            visit(parent->pos, parent->item);
+        }
+        parent = next;
+    }
+}
+
+template<typename Visitor>
+void QGVTilePyramid::forEachDescendant(const QGV::GeoTilePos& tilePos, int toZoom, Visitor visit) const
+{
+    const Node* node = findNode(tilePos);
+    if (node == nullptr) {
+        return;
+    }
+    visitSubtree(node, toZoom, visit);
+}
+
+template<typename Visitor>
+void QGVTilePyramid::takeDescendants(const QGV::GeoTilePos& tilePos, Visitor visit)
+{
+    Node* node = findNode(tilePos);
+    if (node == nullptr || node->presentBelow == 0) {
+        return;
+    }
+    Node* children[4];
+    for (int i = 0; i < 4; ++i) {
+        children[i] = node->children[i];
+        node->children[i] = nullptr;
+        if (children[i] != nullptr) {
+            unlinkSubtree(children[i]);
+        }
+    }
+    adjustPresentBelow(node->parent, -node->presentBelow);
+    node->presentBelow = 0;
+    prune(node);
+    for (Node* child : children) {
+        if (child != nullptr) {
+            takeSubtree(child, visit);
+        }
+    }
+}
+
+template<typename Visitor>
+void QGVTilePyramid::visitSubtree(const Node* node, int toZoom, Visitor& visit) const
+{
+    if (node->pos.zoom() >= toZoom || node->presentBelow == 0) {
+        return;
+    }
+    for (const Node* child : node->children) {
+        if (child == nullptr) {
+            continue;
+        }
+        if (child->present) {
+            visit(child->pos, child->item);
+        }
+        visitSubtree(child, toZoom, visit);
+    }
+}
+
+template<typename Visitor>
+void QGVTilePyramid::takeSubtree(Node* node, Visitor& visit)
+{
+    for (Node* child : node->children) {
+        if (child != nullptr) {
+            takeSubtree(child, visit);
+        }
+    }
+    if (node->present) {
+        visit(node->pos, node->item);
+    }
+    delete node;
+}
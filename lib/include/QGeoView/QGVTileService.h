@@ -0,0 +1,96 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+/*!
+ * Process-wide tile fetching and decoding shared by all online layers of all maps.
+ * Requests are identified by key (normally tile URL), so identical tiles are fetched and decoded only once and
+ * delivered to every subscriber of this key only. Request is aborted when last subscriber cancels it. Network time
+ * is -1 for tiles which were only decoded.
+ */
+class QGV_LIB_DECL QGVTileService : public QObject
+{
+    Q_OBJECT
+
+public:
+    class Subscriber
+    {
+    public:
+        virtual ~Subscriber() = default;
+        virtual void onTileReady(const QString& key,
+                                 const QByteArray& rawData,
+                                 const QImage& image,
+                                 qint64 networkMs,
+                                 qint64 decodeMs) = 0;
+        virtual void onTileFetchFailed(const QString& key,
+                                       QNetworkReply::NetworkError error,
+                                       const QString& errorString) = 0;
+    };
+
+    static QGVTileService* instance();
+
+    void fetch(Subscriber* subscriber, const QString& key, const QNetworkRequest& request);
+    void decode(Subscriber* subscriber, const QString& key, const QByteArray& rawData);
+    void cancel(Subscriber* subscriber, const QString& key);
+    void cancelAll(Subscriber* subscriber);
+
+    int countRequests() const;
+    int countSubscribers(const QString& key) const;
+
+private:
+    class DecodeTask;
+
+    struct Entry
+    {
+        QSet<Subscriber*> subscribers;
+        QPointer<QNetworkReply> reply;
+        DecodeTask* task = nullptr;
+        QElapsedTimer timer;
+        qint64 networkMs = -1;
+    };
+
+    QGVTileService();
+    ~QGVTileService();
+
+    void startDecode(const QString& key, const QByteArray& rawData);
+    void onReplyFinished(const QString& key, QNetworkReply* reply);
+    void onDecoded(const QString& key, const QByteArray& rawData, const QImage& image, qint64 decodeMs);
+    void abort(Entry& entry);
+    void notify(QSet<Subscriber*> subscribers, std::function<void(Subscriber*)> call);
+
+private:
+    QThreadPool mDecodePool;
+    QHash<QString, Entry> mEntries;
+    QVector<QSet<Subscriber*>*> mNotified;
+};
@@ -0,0 +1,101 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <functional>
+
+/*!
+ * Persistent tile storage in single append-only pack file.
+ * Every record keeps layer id, tile position and raw tile data. Index is rebuilt from record headers when file is
+ * opened. When file grows above maximal size, least recently used tiles are dropped by file compaction.
+ * File is opened, written, compacted and read by asynchronous load in one worker thread, so GUI thread never waits
+ * for disk except in synchronous queries, which wait while compaction runs.
+ */
+class QGV_LIB_DECL QGVTileStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QGVTileStore(const QString& fileName, QObject* parent = nullptr);
+    ~QGVTileStore();
+
+    bool isOpen() const;
+    QString getFileName() const;
+
+    void setMaxSize(qint64 bytes);
+    qint64 getMaxSize() const;
+    qint64 getSize() const;
+    int countTiles() const;
+
+    void setOfflineOnly(bool enabled);
+    bool isOfflineOnly() const;
+
+    bool contains(const QString& layerId, const QGV::GeoTilePos& tilePos) const;
+    QByteArray load(const QString& layerId, const QGV::GeoTilePos& tilePos);
+    void load(const QString& layerId,
+              const QGV::GeoTilePos& tilePos,
+              QObject* receiver,
+              std::function<void(const QByteArray&)> onLoaded);
+    void save(const QString& layerId, const QGV::GeoTilePos& tilePos, const QByteArray& rawData);
+    void compact();
+    void clear();
+    void waitForDone();
+
+private:
+    class Job;
+
+    struct Entry
+    {
+        qint64 offset;
+        qint32 size;
+        quint64 access;
+    };
+    using LayerIndex = QHash<QGV::GeoTilePos, Entry>;
+
+    void post(std::function<void()> job);
+    int countEntries() const;
+    QByteArray read(const QString& layerId, const QGV::GeoTilePos& tilePos);
+    bool open();
+    bool readIndex();
+    void compact(qint64 targetSize);
+    bool writeRecord(QFile& file,
+                     const QString& layerId,
+                     const QGV::GeoTilePos& tilePos,
+                     const QByteArray& rawData,
+                     Entry& entry);
+
+private:
+    const QString mFileName;
+    mutable QMutex mMutex;
+    QThreadPool mPool;
+    QFile mFile;
+    qint64 mMaxSize;
+    bool mOfflineOnly;
+    quint64 mAccessCounter;
+    QHash<QString, LayerIndex> mIndex;
+};
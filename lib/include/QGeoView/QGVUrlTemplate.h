@@ -0,0 +1,84 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * Tile URL template parsed once into list of tokens.
+ * Supported placeholders are {z}, {x}, {y}, {-y}, {s} (subdomain), {quadkey} and {bbox} (lonLeft,latBottom,lonRight,
+ * latTop). Any other name, like {r} for resolution suffix, is taken from variables. Legacy ${name} form is accepted
+ * as well and ${qk} is alias of {quadkey}. Subdomains are spread over tiles by tile position unless one is pinned.
+ */
+class QGV_LIB_DECL QGVUrlTemplate
+{
+public:
+    QGVUrlTemplate();
+    explicit QGVUrlTemplate(const QString& pattern, const QStringList& subdomains = {});
+
+    void setPattern(const QString& pattern);
+    QString getPattern() const;
+    bool isEmpty() const;
+
+    void setSubdomains(const QStringList& subdomains);
+    QStringList getSubdomains() const;
+    void setSubdomainIndex(int index);
+    int getSubdomainIndex() const;
+
+    void setVariable(const QString& name, const QString& value);
+    QString getVariable(const QString& name) const;
+
+    QString format(const QGV::GeoTilePos& tilePos) const;
+
+private:
+    enum class TokenType
+    {
+        Literal,
+        Zoom,
+        X,
+        Y,
+        InvertedY,
+        Subdomain,
+        QuadKey,
+        BBox,
+        Variable,
+    };
+
+    struct Token
+    {
+        TokenType type;
+        QString text;
+    };
+
+    void compile();
+    void appendLiteral(const QString& text);
+    void appendPlaceholder(const QString& name);
+
+private:
+    QString mPattern;
+    QStringList mSubdomains;
+    int mSubdomainIndex;
+    QHash<QString, QString> mVariables;
+    QVector<Token> mTokens;
+    int mLiteralSize;
+};
@@ -3,6 +3,10 @@ TEMPLATE = lib
 
 QT += gui widgets network
 
+lessThan(QT_MAJOR_VERSION, 6):lessThan(QT_MINOR_VERSION, 10) {
+    error("QGeoView requires Qt 5.10 or higher")
+}
+
 DEFINES += QGV_EXPORT
 
 HEADERS += \
@@ -16,8 +20,17 @@ HEADERS += \
     $$PWD/include/QGeoView/QGVLayerGoogle.h \
     $$PWD/include/QGeoView/QGVLayerOSM.h \
     $$PWD/include/QGeoView/QGVLayerBDGEx.h \
+    $$PWD/include/QGeoView/QGVLayerBatch.h \
+    $$PWD/include/QGeoView/QGVLayerCluster.h \
     $$PWD/include/QGeoView/QGVLayerTiles.h \
     $$PWD/include/QGeoView/QGVLayerTilesOnline.h \
+    $$PWD/include/QGeoView/QGVTileStore.h \
+    $$PWD/include/QGeoView/QGVTilePyramid.h \
+    $$PWD/include/QGeoView/QGVTileMosaic.h \
+    $$PWD/include/QGeoView/QGVUrlTemplate.h \
+    $$PWD/include/QGeoView/QGVTileService.h \
+    $$PWD/include/QGeoView/QGVTileMetrics.h \
+    $$PWD/include/QGeoView/QGVSpatialIndex.h \
     $$PWD/include/QGeoView/QGVMap.h \
     $$PWD/include/QGeoView/QGVMapQGItem.h \
     $$PWD/include/QGeoView/QGVMapQGView.h \
@@ -43,8 +56,17 @@ SOURCES += \
     $$PWD/src/QGVLayerGoogle.cpp \
     $$PWD/src/QGVLayerOSM.cpp \
     $$PWD/src/QGVLayerBDGEx.cpp \
+    $$PWD/src/QGVLayerBatch.cpp \
+    $$PWD/src/QGVLayerCluster.cpp \
     $$PWD/src/QGVLayerTiles.cpp \
     $$PWD/src/QGVLayerTilesOnline.cpp \
+    $$PWD/src/QGVTileStore.cpp \
+    $$PWD/src/QGVTilePyramid.cpp \
+    $$PWD/src/QGVTileMosaic.cpp \
+    $$PWD/src/QGVUrlTemplate.cpp \
+    $$PWD/src/QGVTileService.cpp \
+    $$PWD/src/QGVTileMetrics.cpp \
+    $$PWD/src/QGVSpatialIndex.cpp \
     $$PWD/src/QGVMap.cpp \
     $$PWD/src/QGVMapQGItem.cpp \
     $$PWD/src/QGVMapQGView.cpp \
@@ -21,11 +21,17 @@
 
 #include <QtMath>
 
-QGVCameraState::QGVCameraState(QGVMap* geoMap, double azimuth, double scale, const QRectF& projRect, bool animation)
+QGVCameraState::QGVCameraState(QGVMap* geoMap,
+                               double azimuth,
+                               double scale,
+                               const QRectF& projRect,
+                               bool animation,
+                               const QPolygonF& projPolygon)
     : mGeoMap(geoMap)
     , mScale(scale)
     , mAzimuth(azimuth)
     , mProjRect(projRect)
+    , mProjPolygon(projPolygon)
     , mAnimation(animation)
 {
     Q_ASSERT(geoMap);
@@ -36,6 +42,7 @@ QGVCameraState::QGVCameraState(const QGVCameraState& other)
     , mScale(other.mScale)
     , mAzimuth(other.mAzimuth)
     , mProjRect(other.mProjRect)
+    , mProjPolygon(other.mProjPolygon)
     , mAnimation(other.mAnimation)
 {
 }
@@ -45,6 +52,7 @@ QGVCameraState::QGVCameraState(const QGVCameraState&& other)
     , mScale(std::move(other.mScale))
     , mAzimuth(std::move(other.mAzimuth))
     , mProjRect(std::move(other.mProjRect))
+    , mProjPolygon(std::move(other.mProjPolygon))
     , mAnimation(std::move(other.mAnimation))
 {
 }
@@ -55,6 +63,7 @@ QGVCameraState& QGVCameraState::operator=(const QGVCameraState& other)
     mScale = other.mScale;
     mAzimuth = other.mAzimuth;
     mProjRect = other.mProjRect;
+    mProjPolygon = other.mProjPolygon;
     mAnimation = other.mAnimation;
     return *this;
 }
@@ -65,6 +74,7 @@ QGVCameraState& QGVCameraState::operator=(const QGVCameraState&& other)
     mScale = std::move(other.mScale);
     mAzimuth = std::move(other.mAzimuth);
     mProjRect = std::move(other.mProjRect);
+    mProjPolygon = std::move(other.mProjPolygon);
     mAnimation = std::move(other.mAnimation);
     return *this;
 }
@@ -94,6 +104,14 @@ QRectF QGVCameraState::projRect() const
     return mProjRect;
 }
 
+QPolygonF QGVCameraState::projPolygon() const
+{
+    if (mProjPolygon.isEmpty()) {
+        return QPolygonF(mProjRect);
+    }
+    return mProjPolygon;
+}
+
 QPointF QGVCameraState::projCenter() const
 {
     return mProjRect.center();
@@ -242,6 +260,14 @@ void QGVCameraAnimation::onStop()
 {
 }
 
+/*
+ * Animation which ends exactly at its actions reports it, so map items can prepare for destination in advance.
+ */
+bool QGVCameraAnimation::isTargetKnown() const
+{
+    return false;
+}
+
 double QGVCameraAnimation::interpolateScale(double from, double to, double progress)
 {
     if (qFuzzyCompare(from, to)) {
@@ -278,6 +304,9 @@ void QGVCameraAnimation::updateState(QAbstractAnimation::State newState, QAbstra
         mActions.rebase(geoMap->getCamera());
         connect(geoMap, &QGVMap::stateChanged, this, &QGVCameraAnimation::onStateChanged);
         onStart();
+        if (isTargetKnown()) {
+            geoMap->onMapCameraTarget(mActions);
+        }
     }
     if (newState == QAbstractAnimation::Stopped && oldState != QAbstractAnimation::Stopped) {
         disconnect(geoMap, nullptr, this, nullptr);
@@ -316,6 +345,11 @@ void QGVCameraSimpleAnimation::setEasingCurve(const QEasingCurve& easing)
     mEasing = easing;
 }
 
+bool QGVCameraSimpleAnimation::isTargetKnown() const
+{
+    return true;
+}
+
 void QGVCameraSimpleAnimation::onProgress(double progress, QGVCameraActions& target)
 {
     progress = mEasing.valueForProgress(progress);
@@ -367,3 +401,8 @@ void QGVCameraFlyAnimation::onProgress(double progress, QGVCameraActions& target
 
     target.rotateTo(interpolateAzimuth(actions().origin().azimuth(), actions().azimuth(), progress));
 }
+
+bool QGVCameraFlyAnimation::isTargetKnown() const
+{
+    return true;
+}
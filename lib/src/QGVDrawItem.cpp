@@ -17,22 +17,33 @@
  ****************************************************************************/
 
 #include "QGVDrawItem.h"
+#include "QGVLayer.h"
 #include "QGVMapQGItem.h"
 #include "QGVMapQGView.h"
 
 namespace {
 double highlightScale = 1.15;
+double viewportMargin = 0.5;
 }
 
 QGVDrawItem::QGVDrawItem()
     : mDirty{ false }
+    , mIndexLayer{ nullptr }
+    , mCameraStale{ false }
+    , mCullValid{ false }
 {
 }
 
+QGVDrawItem::~QGVDrawItem()
+{
+    leaveIndex();
+}
+
 void QGVDrawItem::setFlags(QGV::ItemFlags flags)
 {
     if (mFlags != flags) {
         mFlags = flags;
+        updateCameraSubscription();
         projOnFlags();
         refresh();
     }
@@ -58,11 +69,33 @@ bool QGVDrawItem::isFlag(QGV::ItemFlag flag) const
     return getFlags().testFlag(flag);
 }
 
+QGV::CameraInterests QGVDrawItem::getCameraInterests() const
+{
+    QGV::CameraInterests interests = QGVItem::getCameraInterests();
+    if (mCameraStale && mIndexLayer != nullptr) {
+        return interests;
+    }
+    if (isFlag(QGV::ItemFlag::IgnoreScale)) {
+        interests |= QGV::CameraInterest::Scale;
+    }
+    if (isFlag(QGV::ItemFlag::IgnoreAzimuth)) {
+        interests |= QGV::CameraInterest::Azimuth;
+    }
+    if (mCameraStale && mIndexLayer == nullptr) {
+        interests |= QGV::CameraInterest::Area;
+    }
+    return interests;
+}
+
 void QGVDrawItem::refresh()
 {
     if (mQGDrawItem.isNull()) {
         return;
     }
+    if (defer(DeferRefresh)) {
+        return;
+    }
+    undefer(DeferRefresh);
     if (!isVisible()) {
         mQGDrawItem->hide();
         return;
@@ -95,6 +128,8 @@ void QGVDrawItem::refresh()
     mQGDrawItem->setOpacity(effectiveOpacity());
     mQGDrawItem->setZValue(effectiveZValue());
     mQGDrawItem->setAcceptHoverEvents(isFlag(QGV::ItemFlag::Highlightable));
+    mQGDrawItem->setCacheMode(isFlag(QGV::ItemFlag::NoCache) ? QGraphicsItem::NoCache
+                                                             : QGraphicsItem::DeviceCoordinateCache);
     mQGDrawItem->update();
 
     mDirty = false;
@@ -117,11 +152,32 @@ void QGVDrawItem::repaint()
     }
 }
 
+void QGVDrawItem::repaint(const QRectF& projRect)
+{
+    if (mQGDrawItem.isNull()) {
+        return;
+    }
+
+    if (mDirty) {
+        refresh();
+    } else {
+        mQGDrawItem->update(projRect);
+    }
+}
+
 void QGVDrawItem::resetBoundary()
 {
-    if (!mQGDrawItem.isNull()) {
+    mCullValid = false;
+    if (!mQGDrawItem.isNull() && !defer(DeferBoundary)) {
+        undefer(DeferBoundary);
         mQGDrawItem->resetGeometry();
     }
+    if (mIndexLayer != nullptr) {
+        mIndexLayer->indexItem(this);
+        if (mCameraStale) {
+            mIndexLayer->addStaleItem(this, getStaleReach());
+        }
+    }
 
     if (isFlag(QGV::ItemFlag::Transformed) || isFlag(QGV::ItemFlag::Highlighted) ||
         isFlag(QGV::ItemFlag::IgnoreScale) || isFlag(QGV::ItemFlag::IgnoreAzimuth)) {
@@ -137,6 +193,11 @@ QTransform QGVDrawItem::effectiveTransform() const
     return mQGDrawItem->transform();
 }
 
+bool QGVDrawItem::projContains(const QPointF& projPos) const
+{
+    return projShape().contains(projPos);
+}
+
 QPointF QGVDrawItem::projAnchor() const
 {
     return projShape().boundingRect().center();
@@ -195,6 +256,7 @@ void QGVDrawItem::projOnObjectMovePos(const QPointF& /*projPos*/)
 
 void QGVDrawItem::onProjection(QGVMap* geoMap)
 {
+    mCullValid = false;
     QGVItem::onProjection(geoMap);
     if (!mQGDrawItem.isNull()) {
         if (mQGDrawItem->scene() != geoMap->geoView()->scene()) {
@@ -205,18 +267,15 @@ void QGVDrawItem::onProjection(QGVMap* geoMap)
         mQGDrawItem.reset(new QGVMapQGItem(this));
         geoMap->geoView()->scene()->addItem(mQGDrawItem.data());
     }
+    updateIndex();
 }
 
 void QGVDrawItem::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
 {
-    QGVItem::onCamera(oldState, newState);
-    bool neededUpdate =
-            (mFlags.testFlag(QGV::ItemFlag::IgnoreAzimuth) && !qFuzzyCompare(oldState.azimuth(), newState.azimuth())) ||
-            (mFlags.testFlag(QGV::ItemFlag::IgnoreScale) && !qFuzzyCompare(oldState.scale(), newState.scale()));
-    if (!neededUpdate) {
+    if (!isCameraChanged(oldState, newState) && !mCameraStale) {
         return;
     }
-    refresh();
+    updateCamera(newState);
 }
 
 void QGVDrawItem::onUpdate()
@@ -229,4 +288,137 @@ void QGVDrawItem::onClean()
 {
     QGVItem::onClean();
     mQGDrawItem.reset(nullptr);
+    leaveIndex();
+    mCameraStale = false;
+}
+
+void QGVDrawItem::flushDeferred(int what)
+{
+    if ((what & DeferBoundary) && isDeferred(DeferBoundary)) {
+        resetBoundary();
+    }
+    QGVItem::flushDeferred(what);
+    if ((what & DeferRefresh) && isDeferred(DeferRefresh)) {
+        refresh();
+    }
+}
+
+void QGVDrawItem::updateIndex()
+{
+    QGVLayer* layer = qobject_cast<QGVLayer*>(getParent());
+    if (layer != mIndexLayer) {
+        leaveIndex();
+        mIndexLayer = layer;
+        if (mCameraStale) {
+            if (mIndexLayer != nullptr) {
+                mIndexLayer->addStaleItem(this, getStaleReach());
+            }
+            updateCameraSubscription();
+        }
+    }
+    if (mIndexLayer != nullptr) {
+        mIndexLayer->indexItem(this);
+    }
+}
+
+void QGVDrawItem::validateCull()
+{
+    if (!mCullValid) {
+        mCullRect = projShape().boundingRect();
+        mCullAnchor = projAnchor();
+        mCullValid = true;
+    }
+}
+
+bool QGVDrawItem::isInViewport(const QGVCameraState& camera)
+{
+    if (isFlag(QGV::ItemFlag::Transformed)) {
+        return true;
+    }
+    validateCull();
+    double scale = 1.0;
+    double azimuth = 0.0;
+    if (isFlag(QGV::ItemFlag::Highlighted) && !isFlag(QGV::ItemFlag::HighlightCustom)) {
+        scale *= highlightScale;
+    }
+    if (isFlag(QGV::ItemFlag::IgnoreScale)) {
+        scale *= 1.0 / camera.scale();
+    }
+    if (isFlag(QGV::ItemFlag::IgnoreAzimuth)) {
+        azimuth += -camera.azimuth();
+    }
+    const QRectF itemRect = QGV::createTransfrom(mCullAnchor, scale, azimuth).mapRect(mCullRect);
+    const QRectF areaRect = viewportArea(camera);
+    return itemRect.right() >= areaRect.left() && itemRect.left() <= areaRect.right() &&
+           itemRect.bottom() >= areaRect.top() && itemRect.top() <= areaRect.bottom();
+}
+
+bool QGVDrawItem::isCameraChanged(const QGVCameraState& oldState, const QGVCameraState& newState) const
+{
+    return (isFlag(QGV::ItemFlag::IgnoreAzimuth) && !qFuzzyCompare(oldState.azimuth(), newState.azimuth())) ||
+           (isFlag(QGV::ItemFlag::IgnoreScale) && !qFuzzyCompare(oldState.scale(), newState.scale()));
+}
+
+/*
+ * Items far from viewport are not refreshed. They leave camera notifications and their layer finds them by its index
+ * when camera brings them close to viewport, items without layer subscribe to area changes instead.
+ */
+void QGVDrawItem::updateCamera(const QGVCameraState& camera)
+{
+    const bool stale = !isInViewport(camera);
+    setCameraStale(stale);
+    if (!stale) {
+        refresh();
+    }
+}
+
+void QGVDrawItem::setCameraStale(bool stale)
+{
+    if (mCameraStale == stale) {
+        return;
+    }
+    mCameraStale = stale;
+    if (mIndexLayer != nullptr) {
+        if (stale) {
+            mIndexLayer->addStaleItem(this, getStaleReach());
+        } else {
+            mIndexLayer->removeStaleItem(this);
+        }
+    }
+    updateCameraSubscription();
+}
+
+/*
+ * Largest distance from anchor to item boundary in projection units at scale 1.
+ */
+double QGVDrawItem::getStaleReach()
+{
+    validateCull();
+    double reach = 0;
+    const QPointF corners[] = { mCullRect.topLeft(), mCullRect.topRight(), mCullRect.bottomLeft(),
+                                mCullRect.bottomRight() };
+    for (const QPointF& corner : corners) {
+        reach = qMax(reach, QLineF(mCullAnchor, corner).length());
+    }
+    return reach * highlightScale;
+}
+
+QRectF QGVDrawItem::viewportArea(const QGVCameraState& camera)
+{
+    const QRectF viewRect = camera.projRect();
+    const double marginX = viewRect.width() * viewportMargin;
+    const double marginY = viewRect.height() * viewportMargin;
+    return viewRect.adjusted(-marginX, -marginY, marginX, marginY);
+}
+
+void QGVDrawItem::leaveIndex()
+{
+    if (mIndexLayer != nullptr) {
+        mIndexLayer->removeStaleItem(this);
+        mIndexLayer->unindexItem(this);
+        mIndexLayer = nullptr;
+        if (mCameraStale) {
+            updateCameraSubscription();
+        }
+    }
 }
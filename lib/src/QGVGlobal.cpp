@@ -290,6 +290,16 @@ bool GeoTilePos::operator<(const GeoTilePos& other) const
     return mPos.y() < other.mPos.y();
 }
 
+bool GeoTilePos::operator==(const GeoTilePos& other) const
+{
+    return mZoom == other.mZoom && mPos == other.mPos;
+}
+
+bool GeoTilePos::operator!=(const GeoTilePos& other) const
+{
+    return !(*this == other);
+}
+
 int GeoTilePos::zoom() const
 {
     return mZoom;
@@ -342,6 +352,7 @@ QString GeoTilePos::toQuadKey() const
     const int x = mPos.x();
     const int y = mPos.y();
     QString quadKey;
+    quadKey.reserve(mZoom);
     for (int i = mZoom; i > 0; i--) {
         char cDigit = '0';
         int iMask = 1 << (i - 1);
@@ -367,6 +378,18 @@ GeoTilePos GeoTilePos::geoToTilePos(int zoom, const GeoPos& geoPos)
     return GeoTilePos(zoom, QPoint(static_cast<int>(x), static_cast<int>(y)));
 }
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+size_t qHash(const GeoTilePos& key, size_t seed)
+#else
+uint qHash(const GeoTilePos& key, uint seed)
+#endif
+{
+    const quint64 zoom = static_cast<quint64>(key.zoom()) & 0x3F;
+    const quint64 x = static_cast<quint64>(key.pos().x()) & 0x1FFFFFFF;
+    const quint64 y = static_cast<quint64>(key.pos().y()) & 0x1FFFFFFF;
+    return ::qHash((zoom << 58) | (x << 29) | y, seed);
+}
+
 QTransform createTransfrom(const QPointF& projAnchor, double scale, double azimuth)
 {
     const bool scaleChanged = !qFuzzyCompare(scale, 1.0);
@@ -17,23 +17,53 @@
  ****************************************************************************/
 
 #include "QGVItem.h"
+#include <QSet>
 #include <limits>
 
+/*
+ * Children are kept in vector and every child remembers its slot, so child is detached in constant time by leaving
+ * hole in its slot. Holes are compacted when they take half of vector and nobody iterates over children.
+ */
+template<typename Visitor>
+void QGVItem::forEachChild(Visitor visit)
+{
+    mChildVisits++;
+    for (int i = 0; i < mChildrens.size(); ++i) {
+        QGVItem* obj = mChildrens.at(i);
+        if (obj != nullptr) {
+            visit(obj);
+        }
+    }
+    mChildVisits--;
+    if (mChildVisits == 0 && mChildHoles > mChildrens.size() / 2) {
+        compactChildren();
+    }
+}
+
 QGVItem::QGVItem(QGVItem* parent)
 {
     mParent = parent;
     mZValue = 0;
     mOpacity = 1.0;
     mVisible = true;
+    mEffectiveValid = false;
     mSelectable = false;
     mSelected = false;
+    mCameraMap = nullptr;
+    mDeferred = 0;
+    mParentSlot = -1;
+    mChildVisits = 0;
+    mChildHoles = 0;
 }
 
 QGVItem::~QGVItem()
 {
+    if (mCameraMap != nullptr) {
+        mCameraMap->unsubscribeCamera(this);
+    }
     deleteItems();
     if (mParent != nullptr) {
-        mParent->mChildrens.removeAll(this);
+        mParent->detachChild(this);
     }
 }
 
@@ -44,12 +74,13 @@ void QGVItem::setParent(QGVItem* item)
     }
     setSelected(false);
     if (mParent != nullptr) {
-        mParent->mChildrens.removeAll(this);
+        mParent->detachChild(this);
     }
     auto oldParent = mParent;
     mParent = item;
+    invalidateEffective();
     if (mParent != nullptr) {
-        mParent->mChildrens.append(this);
+        mParent->attachChild(this);
     }
     auto geoMap = getMap();
     if (geoMap != nullptr) {
@@ -85,6 +116,49 @@ void QGVItem::addItem(QGVItem* item)
     item->setParent(this);
 }
 
+void QGVItem::addItems(const QList<QGVItem*>& items)
+{
+    /*
+     * Items are attached first and projected after that, so map is notified once per changed parent.
+     */
+    QList<QGVItem*> added;
+    QSet<QGVItem*> oldParents;
+    mChildrens.reserve(mChildrens.size() + items.size());
+    for (QGVItem* item : items) {
+        Q_ASSERT(item);
+        if (item->mParent == this) {
+            continue;
+        }
+        item->setSelected(false);
+        if (item->mParent != nullptr) {
+            oldParents.insert(item->mParent);
+            item->mParent->detachChild(item);
+        }
+        item->mParent = this;
+        item->invalidateEffective();
+        attachChild(item);
+        added.append(item);
+    }
+    if (added.isEmpty()) {
+        return;
+    }
+    auto geoMap = getMap();
+    if (geoMap == nullptr) {
+        for (QGVItem* item : added) {
+            item->onClean();
+        }
+        return;
+    }
+    for (QGVItem* oldParent : oldParents) {
+        Q_EMIT geoMap->itemsChanged(oldParent);
+    }
+    Q_EMIT geoMap->itemsChanged(this);
+    for (QGVItem* item : added) {
+        item->onProjection(geoMap);
+        item->update();
+    }
+}
+
 void QGVItem::removeItem(QGVItem* item)
 {
     Q_ASSERT(item);
@@ -94,27 +168,76 @@ void QGVItem::removeItem(QGVItem* item)
     item->setParent(nullptr);
 }
 
+void QGVItem::removeItems(const QList<QGVItem*>& items)
+{
+    bool removed = false;
+    for (QGVItem* item : items) {
+        Q_ASSERT(item);
+        if (item->mParent != this) {
+            continue;
+        }
+        item->setSelected(false);
+        detachChild(item);
+        item->mParent = nullptr;
+        item->invalidateEffective();
+        item->onClean();
+        removed = true;
+    }
+    auto geoMap = getMap();
+    if (removed && geoMap != nullptr) {
+        Q_EMIT geoMap->itemsChanged(this);
+    }
+}
+
+QList<QGVItem*> QGVItem::takeItems()
+{
+    QList<QGVItem*> items;
+    items.reserve(countItems());
+    for (QGVItem* obj : mChildrens) {
+        if (obj != nullptr) {
+            items.append(obj);
+        }
+    }
+    removeItems(items);
+    return items;
+}
+
 void QGVItem::deleteItems()
 {
-    auto copy = mChildrens;
-    qDeleteAll(copy.begin(), copy.end());
+    const auto copy = mChildrens;
+    for (int i = copy.size() - 1; i >= 0; --i) {
+        delete copy.at(i);
+    }
     mChildrens.clear();
+    mChildHoles = 0;
 }
 
 int QGVItem::countItems() const
 {
-    return mChildrens.count();
+    return mChildrens.size() - mChildHoles;
 }
 
 QGVItem* QGVItem::getItem(int index) const
 {
-    return mChildrens.at(index);
+    if (mChildHoles > 0 && mChildVisits == 0) {
+        compactChildren();
+    }
+    if (mChildHoles == 0) {
+        return mChildrens.at(index);
+    }
+    for (QGVItem* obj : mChildrens) {
+        if (obj != nullptr && index-- == 0) {
+            return obj;
+        }
+    }
+    return nullptr;
 }
 
 void QGVItem::setZValue(qint16 zValue)
 {
     if (mZValue != zValue) {
         mZValue = zValue;
+        invalidateEffective();
         update();
     }
 }
@@ -127,12 +250,14 @@ qint16 QGVItem::getZValue() const
 void QGVItem::bringToFront()
 {
     mZValue = std::numeric_limits<decltype(mZValue)>::max();
+    invalidateEffective();
     update();
 }
 
 void QGVItem::sendToBack()
 {
     mZValue = std::numeric_limits<decltype(mZValue)>::min();
+    invalidateEffective();
     update();
 }
 
@@ -143,6 +268,7 @@ void QGVItem::setOpacity(double value)
         return;
     }
     mOpacity = value;
+    invalidateEffective();
     update();
 }
 
@@ -206,6 +332,7 @@ void QGVItem::setVisible(bool visible)
         return;
     }
     mVisible = visible;
+    invalidateEffective();
     update();
 }
 
@@ -214,6 +341,17 @@ bool QGVItem::isVisible() const
     return mVisible;
 }
 
+void QGVItem::setCameraInterests(QGV::CameraInterests interests)
+{
+    mCameraInterests = interests;
+    updateCameraSubscription();
+}
+
+QGV::CameraInterests QGVItem::getCameraInterests() const
+{
+    return mCameraInterests;
+}
+
 void QGVItem::show()
 {
     setVisible(true);
@@ -226,68 +364,187 @@ void QGVItem::hide()
 
 double QGVItem::effectiveZValue() const
 {
-    if (mParent == nullptr) {
-        return mZValue;
-    }
-    const auto den = std::numeric_limits<decltype(mZValue)>::max() - std::numeric_limits<decltype(mZValue)>::min();
-    double range = 1.0;
-    for (QGVItem* obj = mParent->getParent(); obj != nullptr; obj = obj->getParent()) {
-        range *= 1.0 / den;
-    }
-    const double efZValue = range * mZValue / den;
-    return mParent->effectiveZValue() + efZValue;
+    calculateEffective();
+    return mEffectiveZValue;
 }
 
 double QGVItem::effectiveOpacity() const
 {
-    if (mParent == nullptr) {
-        return mOpacity;
-    }
-    return mOpacity * mParent->effectiveOpacity();
+    calculateEffective();
+    return mEffectiveOpacity;
 }
 
 bool QGVItem::effectivelyVisible() const
 {
-    if (mParent == nullptr) {
-        return mVisible;
-    }
-    return mVisible && mParent->effectivelyVisible();
+    calculateEffective();
+    return mEffectiveVisible;
 }
 
 void QGVItem::update()
 {
-    if (getMap() == nullptr) {
+    if (getMap() == nullptr || defer(DeferUpdate)) {
         return;
     }
-    for (QGVItem* obj : mChildrens) {
-        obj->update();
-    }
+    undefer(DeferUpdate);
+    forEachChild([](QGVItem* obj) { obj->update(); });
     onUpdate();
 }
 
 void QGVItem::onProjection(QGVMap* geoMap)
 {
-    for (QGVItem* obj : mChildrens) {
-        obj->onProjection(geoMap);
+    updateCameraSubscription();
+    forEachChild([geoMap](QGVItem* obj) { obj->onProjection(geoMap); });
+}
+
+void QGVItem::onCamera(const QGVCameraState& /*oldState*/, const QGVCameraState& /*newState*/)
+{
+}
+
+void QGVItem::onCameraTarget(const QGVCameraActions& /*target*/)
+{
+}
+
+void QGVItem::onUpdate()
+{
+}
+
+void QGVItem::onClean()
+{
+    if (mCameraMap != nullptr) {
+        mCameraMap->unsubscribeCamera(this);
+        mCameraMap = nullptr;
     }
+    forEachChild([](QGVItem* obj) { obj->onClean(); });
 }
 
-void QGVItem::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
+bool QGVItem::defer(int what)
 {
-    for (QGVItem* obj : mChildrens) {
-        if (obj->isVisible()) {
-            obj->onCamera(oldState, newState);
+    /*
+     * Work requested during map update transaction is remembered and done once when transaction ends.
+     */
+    QGVMap* geoMap = getMap();
+    if (geoMap == nullptr || !geoMap->isUpdating()) {
+        return false;
+    }
+    if (mDeferred == 0) {
+        geoMap->deferItem(this);
+    }
+    mDeferred |= what;
+    return true;
+}
+
+void QGVItem::undefer(int what)
+{
+    mDeferred &= ~what;
+}
+
+bool QGVItem::isDeferred(int what) const
+{
+    return (mDeferred & what) != 0;
+}
+
+void QGVItem::flushDeferred(int what)
+{
+    if ((what & DeferUpdate) && isDeferred(DeferUpdate)) {
+        update();
+    }
+}
+
+void QGVItem::updateCameraSubscription()
+{
+    /*
+     * Map calls onCamera and onCameraTarget only for subscribed items, so items without interests cost nothing on
+     * camera change.
+     */
+    QGVMap* geoMap = getMap();
+    const bool subscribe = (geoMap != nullptr && getCameraInterests() != QGV::CameraInterests());
+    if (mCameraMap != nullptr && (!subscribe || mCameraMap != geoMap)) {
+        mCameraMap->unsubscribeCamera(this);
+        mCameraMap = nullptr;
+    }
+    if (subscribe && mCameraMap == nullptr) {
+        mCameraMap = geoMap;
+        mCameraMap->subscribeCamera(this);
+    }
+}
+
+void QGVItem::attachChild(QGVItem* item)
+{
+    item->mParentSlot = mChildrens.size();
+    mChildrens.append(item);
+}
+
+void QGVItem::detachChild(QGVItem* item)
+{
+    /*
+     * Item created with parent by constructor is not attached to it.
+     */
+    const int slot = item->mParentSlot;
+    if (slot < 0) {
+        return;
+    }
+    Q_ASSERT(slot < mChildrens.size() && mChildrens.at(slot) == item);
+    item->mParentSlot = -1;
+    if (slot == mChildrens.size() - 1 && mChildVisits == 0) {
+        mChildrens.removeLast();
+        while (!mChildrens.isEmpty() && mChildrens.last() == nullptr) {
+            mChildrens.removeLast();
+            mChildHoles--;
+        }
+        return;
+    }
+    mChildrens[slot] = nullptr;
+    mChildHoles++;
+    if (mChildVisits == 0 && mChildHoles > mChildrens.size() / 2) {
+        compactChildren();
+    }
+}
+
+void QGVItem::compactChildren() const
+{
+    int count = 0;
+    for (int i = 0; i < mChildrens.size(); ++i) {
+        QGVItem* obj = mChildrens.at(i);
+        if (obj != nullptr) {
+            obj->mParentSlot = count;
+            mChildrens[count++] = obj;
         }
     }
+    mChildrens.resize(count);
+    mChildHoles = 0;
 }
 
-void QGVItem::onUpdate()
+void QGVItem::calculateEffective() const
 {
+    /*
+     * Cached values of item are valid only when values of all its parents are valid, so invalidation stops at items
+     * which are already invalid.
+     */
+    if (mEffectiveValid) {
+        return;
+    }
+    if (mParent == nullptr) {
+        mEffectiveZValue = mZValue;
+        mEffectiveZRange = 1.0;
+        mEffectiveOpacity = mOpacity;
+        mEffectiveVisible = mVisible;
+    } else {
+        mParent->calculateEffective();
+        const auto den = std::numeric_limits<decltype(mZValue)>::max() - std::numeric_limits<decltype(mZValue)>::min();
+        const double range = mParent->mEffectiveZRange;
+        mEffectiveZValue = mParent->mEffectiveZValue + range * mZValue / den;
+        mEffectiveZRange = range * (1.0 / den);
+        mEffectiveOpacity = mOpacity * mParent->mEffectiveOpacity;
+        mEffectiveVisible = mVisible && mParent->mEffectiveVisible;
+    }
+    mEffectiveValid = true;
 }
 
-void QGVItem::onClean()
+void QGVItem::invalidateEffective()
 {
-    for (QGVItem* obj : mChildrens) {
-        obj->onClean();
+    if (!mEffectiveValid) {
+        return;
     }
+    mEffectiveValid = false;
+    forEachChild([](QGVItem* obj) { obj->invalidateEffective(); });
 }
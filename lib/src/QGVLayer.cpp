@@ -17,6 +17,22 @@
  ****************************************************************************/
 
 #include "QGVLayer.h"
+#include "QGVDrawItem.h"
+
+#include <QtMath>
+
+QGVLayer::QGVLayer()
+    : mStaleReach(0)
+{
+}
+
+QGVLayer::~QGVLayer()
+{
+    /*
+     * Items leave index while deleted, so they are deleted before index.
+     */
+    deleteItems();
+}
 
 void QGVLayer::setName(const QString& name)
 {
@@ -37,3 +53,161 @@ QString QGVLayer::getDescription() const
 {
     return mDescription;
 }
+
+QList<QGVDrawItem*> QGVLayer::search(const QRectF& projRect) const
+{
+    QList<QGVDrawItem*> result;
+    flushIndex();
+    mIndex.search(projRect, result);
+    return result;
+}
+
+QList<QGVDrawItem*> QGVLayer::search(const QGV::GeoRect& geoRect) const
+{
+    if (getMap() == nullptr) {
+        return {};
+    }
+    return search(getMap()->getProjection()->geoToProj(geoRect));
+}
+
+QList<QGVDrawItem*> QGVLayer::search(const QGV::GeoPos& geoPos, double radiusMeters) const
+{
+    if (getMap() == nullptr) {
+        return {};
+    }
+    /*
+     * Candidates are taken by geo rectangle around circle and then checked by geodesic distance to nearest point
+     * of item bounding rectangle.
+     */
+    const QGVProjection* projection = getMap()->getProjection();
+    const QGV::GeoRect boundary = projection->boundaryGeoRect();
+    const double latDelta = projection->geodesicDegrees(radiusMeters);
+    const double latCos = qCos(qDegreesToRadians(geoPos.latitude()));
+    const double lonDelta = (latCos > 0) ? qMin(latDelta / latCos, 360.0) : 360.0;
+    const QGV::GeoRect geoRect(qBound(boundary.bottomRight().latitude(), geoPos.latitude() + latDelta,
+                                      boundary.topLeft().latitude()),
+                               qBound(boundary.topLeft().longitude(), geoPos.longitude() - lonDelta,
+                                      boundary.bottomRight().longitude()),
+                               qBound(boundary.bottomRight().latitude(), geoPos.latitude() - latDelta,
+                                      boundary.topLeft().latitude()),
+                               qBound(boundary.topLeft().longitude(), geoPos.longitude() + lonDelta,
+                                      boundary.bottomRight().longitude()));
+    const QPointF projPos = projection->geoToProj(geoPos);
+    QList<QGVDrawItem*> result;
+    for (QGVDrawItem* item : search(projection->geoToProj(geoRect))) {
+        const QRectF projRect = mIndex.rect(item);
+        const QPointF nearest(qBound(projRect.left(), projPos.x(), projRect.right()),
+                              qBound(projRect.top(), projPos.y(), projRect.bottom()));
+        if (projection->geodesicMeters(projPos, nearest) <= radiusMeters) {
+            result.append(item);
+        }
+    }
+    return result;
+}
+
+QList<QGVDrawItem*> QGVLayer::searchNearest(const QGV::GeoPos& geoPos, int count) const
+{
+    if (getMap() == nullptr) {
+        return {};
+    }
+    QList<QGVDrawItem*> result;
+    flushIndex();
+    mIndex.nearest(getMap()->getProjection()->geoToProj(geoPos), count, result);
+    return result;
+}
+
+QGV::CameraInterests QGVLayer::getCameraInterests() const
+{
+    QGV::CameraInterests interests = QGVItem::getCameraInterests();
+    if (!mStaleItems.isEmpty()) {
+        interests |= QGV::CameraInterest::Area | QGV::CameraInterest::Scale | QGV::CameraInterest::Azimuth;
+    }
+    return interests;
+}
+
+void QGVLayer::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
+{
+    QGVItem::onCamera(oldState, newState);
+    if (mStaleItems.isEmpty()) {
+        return;
+    }
+    /*
+     * Stale items get no camera notifications, so ones close to viewport are found by index. Search area is widened
+     * by largest stale item as drawn at new scale, because items are indexed by their unscaled shape.
+     */
+    const double reach = mStaleReach * (qMax(1.0, 1.0 / newState.scale()) + 1.0);
+    const QRectF areaRect = QGVDrawItem::viewportArea(newState).adjusted(-reach, -reach, reach, reach);
+    for (QGVDrawItem* item : search(areaRect)) {
+        if (mStaleItems.contains(item)) {
+            item->updateCamera(newState);
+        }
+    }
+}
+
+void QGVLayer::flushIndex() const
+{
+    /*
+     * Geometry of items is read only when index is queried, because items calculate projection after base class
+     * is notified.
+     */
+    if (mIndexDirty.isEmpty()) {
+        return;
+    }
+    QGVLayer* self = const_cast<QGVLayer*>(this);
+    const auto dirty = mIndexDirty;
+    mIndexDirty.clear();
+    for (QGVDrawItem* item : dirty) {
+        if (item->getMap() != nullptr) {
+            const QRectF projRect = item->projShape().boundingRect();
+            mIndex.insert(item, projRect);
+            self->onItemIndexed(item, projRect);
+        } else {
+            mIndex.remove(item);
+            self->onItemUnindexed(item);
+        }
+    }
+}
+
+void QGVLayer::onIndexChanged()
+{
+}
+
+void QGVLayer::onItemIndexed(QGVDrawItem* /*item*/, const QRectF& /*projRect*/)
+{
+}
+
+void QGVLayer::onItemUnindexed(QGVDrawItem* /*item*/)
+{
+}
+
+void QGVLayer::indexItem(QGVDrawItem* item)
+{
+    mIndexDirty.insert(item);
+    onIndexChanged();
+}
+
+void QGVLayer::unindexItem(QGVDrawItem* item)
+{
+    mIndexDirty.remove(item);
+    mIndex.remove(item);
+    onItemUnindexed(item);
+}
+
+void QGVLayer::addStaleItem(QGVDrawItem* item, double reach)
+{
+    const bool subscribe = mStaleItems.isEmpty();
+    mStaleItems.insert(item);
+    mStaleReach = qMax(mStaleReach, reach);
+    if (subscribe) {
+        updateCameraSubscription();
+    }
+}
+
+void QGVLayer::removeStaleItem(QGVDrawItem* item)
+{
+    if (!mStaleItems.remove(item) || !mStaleItems.isEmpty()) {
+        return;
+    }
+    mStaleReach = 0;
+    updateCameraSubscription();
+}
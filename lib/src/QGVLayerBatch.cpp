@@ -0,0 +1,506 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerBatch.h"
+#include "QGVDrawItem.h"
+
+#include <QGuiApplication>
+#include <QPainter>
+#include <QtMath>
+
+#include <algorithm>
+
+namespace {
+const int maxGridSide = 256;
+const double primitivesPerCell = 2.0;
+}
+
+class QGVLayerBatch::BatchItem : public QGVDrawItem
+{
+public:
+    explicit BatchItem(QGVLayerBatch* layer);
+
+    QPainterPath projShape() const override;
+    bool projContains(const QPointF& projPos) const override;
+    void projPaint(QPainter* painter) override;
+    QString projTooltip(const QPointF& projPos) const override;
+    void projOnMouseClick(const QPointF& projPos) override;
+    void projOnMouseDoubleClick(const QPointF& projPos) override;
+
+private:
+    QGVLayerBatch* mLayer;
+};
+
+QGVLayerBatch::BatchItem::BatchItem(QGVLayerBatch* layer)
+    : mLayer(layer)
+{
+    setFlag(QGV::ItemFlag::NoCache);
+    setFlag(QGV::ItemFlag::Clickable);
+    setSelectable(false);
+}
+
+QPainterPath QGVLayerBatch::BatchItem::projShape() const
+{
+    QPainterPath path;
+    path.addRect(mLayer->mProjBoundary);
+    return path;
+}
+
+bool QGVLayerBatch::BatchItem::projContains(const QPointF& projPos) const
+{
+    return mLayer->primitiveAt(projPos) >= 0;
+}
+
+void QGVLayerBatch::BatchItem::projPaint(QPainter* painter)
+{
+    mLayer->paintPrimitives(painter);
+}
+
+QString QGVLayerBatch::BatchItem::projTooltip(const QPointF& projPos) const
+{
+    return mLayer->getPrimitiveTooltip(mLayer->primitiveAt(projPos));
+}
+
+void QGVLayerBatch::BatchItem::projOnMouseClick(const QPointF& projPos)
+{
+    mLayer->clickPrimitive(projPos);
+    QGVDrawItem::projOnMouseClick(projPos);
+}
+
+void QGVLayerBatch::BatchItem::projOnMouseDoubleClick(const QPointF& projPos)
+{
+    const int index = mLayer->primitiveAt(projPos);
+    if (index >= 0) {
+        Q_EMIT mLayer->primitiveDoubleClicked(index);
+    }
+    QGVDrawItem::projOnMouseDoubleClick(projPos);
+}
+
+QGVLayerBatch::QGVLayerBatch()
+    : mItem(new BatchItem(this))
+    , mSelectedCount(0)
+    , mPen(QBrush(Qt::black), 1)
+    , mGridDirty(true)
+    , mGridCols(0)
+    , mGridRows(0)
+{
+    mPen.setCosmetic(true);
+    addItem(mItem);
+}
+
+QGVLayerBatch::~QGVLayerBatch()
+{
+    /*
+     * Scene item asks layer for its boundary while removed from scene, so it is deleted before layer data.
+     */
+    deleteItems();
+}
+
+int QGVLayerBatch::addPrimitive(Shape shape, const QGV::GeoRect& geoRect, const QColor& color)
+{
+    const int index = mGeoRects.size();
+    mGeoRects.append(geoRect);
+    mProjRects.append(QRectF());
+    mColors.append(color.rgba());
+    mShapes.append(static_cast<quint8>(shape));
+    mSelected.append(false);
+    projectPrimitive(index);
+    return index;
+}
+
+void QGVLayerBatch::reservePrimitives(int count)
+{
+    mGeoRects.reserve(count);
+    mProjRects.reserve(count);
+    mColors.reserve(count);
+    mShapes.reserve(count);
+    mSelected.reserve(count);
+}
+
+void QGVLayerBatch::clearPrimitives()
+{
+    mGeoRects.clear();
+    mProjRects.clear();
+    mColors.clear();
+    mShapes.clear();
+    mSelected.clear();
+    mSelectedCount = 0;
+    mTooltips.clear();
+    mProjBoundary = QRectF();
+    mGridCells.clear();
+    mGridDirty = true;
+    mItem->resetBoundary();
+    mItem->repaint();
+}
+
+int QGVLayerBatch::countPrimitives() const
+{
+    return mGeoRects.size();
+}
+
+QGVLayerBatch::Shape QGVLayerBatch::getPrimitiveShape(int index) const
+{
+    return static_cast<Shape>(mShapes.value(index));
+}
+
+void QGVLayerBatch::setPrimitiveRect(int index, const QGV::GeoRect& geoRect)
+{
+    if (index < 0 || index >= mGeoRects.size()) {
+        return;
+    }
+    mGeoRects[index] = geoRect;
+    projectPrimitive(index);
+}
+
+QGV::GeoRect QGVLayerBatch::getPrimitiveRect(int index) const
+{
+    return mGeoRects.value(index);
+}
+
+void QGVLayerBatch::setPrimitiveColor(int index, const QColor& color)
+{
+    if (index < 0 || index >= mColors.size() || mColors.at(index) == color.rgba()) {
+        return;
+    }
+    mColors[index] = color.rgba();
+    mItem->repaint(mProjRects.at(index));
+}
+
+QColor QGVLayerBatch::getPrimitiveColor(int index) const
+{
+    return QColor::fromRgba(mColors.value(index));
+}
+
+void QGVLayerBatch::setPrimitiveTooltip(int index, const QString& text)
+{
+    if (text.isEmpty()) {
+        mTooltips.remove(index);
+    } else if (index >= 0 && index < mGeoRects.size()) {
+        mTooltips.insert(index, text);
+    }
+}
+
+QString QGVLayerBatch::getPrimitiveTooltip(int index) const
+{
+    return mTooltips.value(index);
+}
+
+void QGVLayerBatch::setPrimitiveSelected(int index, bool selected)
+{
+    if (index < 0 || index >= mSelected.size() || mSelected.at(index) == selected) {
+        return;
+    }
+    mSelected[index] = selected;
+    mSelectedCount += (selected) ? 1 : -1;
+    mItem->repaint(mProjRects.at(index));
+}
+
+bool QGVLayerBatch::isPrimitiveSelected(int index) const
+{
+    return mSelected.value(index, false);
+}
+
+QVector<int> QGVLayerBatch::getSelectedPrimitives() const
+{
+    QVector<int> result;
+    result.reserve(mSelectedCount);
+    for (int i = 0; i < mSelected.size() && result.size() < mSelectedCount; ++i) {
+        if (mSelected.at(i)) {
+            result.append(i);
+        }
+    }
+    return result;
+}
+
+void QGVLayerBatch::unselectPrimitives()
+{
+    if (mSelectedCount == 0) {
+        return;
+    }
+    mSelected.fill(false);
+    mSelectedCount = 0;
+    mItem->repaint();
+}
+
+void QGVLayerBatch::setPen(const QPen& pen)
+{
+    mPen = pen;
+    mItem->repaint();
+}
+
+QPen QGVLayerBatch::getPen() const
+{
+    return mPen;
+}
+
+int QGVLayerBatch::primitiveAt(const QPointF& projPos) const
+{
+    if (!mProjBoundary.contains(projPos)) {
+        return -1;
+    }
+    if (mGridDirty) {
+        rebuildGrid();
+    }
+    if (mGridCells.isEmpty()) {
+        return -1;
+    }
+    const QRect cells = gridCells(QRectF(projPos, projPos));
+    int result = -1;
+    for (int index : mGridCells.at(cells.top() * mGridCols + cells.left())) {
+        if (index > result && isPrimitiveAt(index, projPos)) {
+            result = index;
+        }
+    }
+    return result;
+}
+
+QVector<int> QGVLayerBatch::primitivesIn(const QRectF& projRect) const
+{
+    QVector<int> result;
+    findPrimitives(projRect, result);
+    return result;
+}
+
+void QGVLayerBatch::onProjection(QGVMap* geoMap)
+{
+    mProjBoundary = QRectF();
+    for (int i = 0; i < mGeoRects.size(); ++i) {
+        mProjRects[i] = geoMap->getProjection()->geoToProj(mGeoRects.at(i)).normalized();
+        mProjBoundary |= mProjRects.at(i);
+    }
+    mGridCells.clear();
+    mGridDirty = true;
+    QGVLayer::onProjection(geoMap);
+    mItem->resetBoundary();
+}
+
+bool QGVLayerBatch::isPrimitiveAt(int index, const QPointF& projPos) const
+{
+    const QRectF& projRect = mProjRects.at(index);
+    if (!projRect.contains(projPos)) {
+        return false;
+    }
+    if (mShapes.at(index) != static_cast<quint8>(Shape::Ellipse)) {
+        return true;
+    }
+    const double rx = projRect.width() / 2;
+    const double ry = projRect.height() / 2;
+    const QPointF delta = projPos - projRect.center();
+    return (delta.x() * delta.x()) / (rx * rx) + (delta.y() * delta.y()) / (ry * ry) <= 1.0;
+}
+
+void QGVLayerBatch::projectPrimitive(int index)
+{
+    if (getMap() == nullptr) {
+        return;
+    }
+    const QRectF oldProjRect = mProjRects.at(index);
+    const QRectF newProjRect = getMap()->getProjection()->geoToProj(mGeoRects.at(index)).normalized();
+    mProjRects[index] = newProjRect;
+    if (!mProjBoundary.contains(newProjRect)) {
+        mProjBoundary |= newProjRect;
+        mItem->resetBoundary();
+    }
+    /*
+     * Grid is rebuilt on next query when primitive leaves it, so bulk adding does not rebuild it every time.
+     */
+    if (!mGridDirty) {
+        if (mGridCells.isEmpty() || !mGridRect.contains(newProjRect)) {
+            mGridCells.clear();
+            mGridDirty = true;
+        } else {
+            if (!oldProjRect.isNull()) {
+                unindexPrimitive(index, oldProjRect);
+            }
+            if (!newProjRect.isNull()) {
+                indexPrimitive(index);
+            }
+        }
+    }
+    mItem->repaint(oldProjRect | newProjRect);
+}
+
+void QGVLayerBatch::findPrimitives(const QRectF& projRect, QVector<int>& result) const
+{
+    result.clear();
+    if (!mProjBoundary.intersects(projRect)) {
+        return;
+    }
+    if (mGridDirty) {
+        rebuildGrid();
+    }
+    const QRect cells = (mGridCells.isEmpty()) ? QRect() : gridCells(projRect);
+    if (cells.isEmpty() || cells.width() * cells.height() >= mGridCells.size()) {
+        for (int i = 0; i < mProjRects.size(); ++i) {
+            if (mProjRects.at(i).intersects(projRect)) {
+                result.append(i);
+            }
+        }
+        return;
+    }
+    for (int row = cells.top(); row <= cells.bottom(); ++row) {
+        for (int col = cells.left(); col <= cells.right(); ++col) {
+            for (int index : mGridCells.at(row * mGridCols + col)) {
+                if (mProjRects.at(index).intersects(projRect)) {
+                    result.append(index);
+                }
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+/*
+ * Grid covers current projected boundary with about primitivesPerCell primitives per cell, but cells are not made
+ * smaller than average primitive, so primitive is usually kept by few cells only.
+ */
+void QGVLayerBatch::rebuildGrid() const
+{
+    mGridDirty = false;
+    mGridCells.clear();
+    mGridRect = mProjBoundary;
+    const int count = mProjRects.size();
+    if (count == 0 || mGridRect.isNull()) {
+        mGridCols = 0;
+        mGridRows = 0;
+        return;
+    }
+    double sumWidth = 0;
+    double sumHeight = 0;
+    for (const QRectF& projRect : mProjRects) {
+        sumWidth += projRect.width();
+        sumHeight += projRect.height();
+    }
+    const int side = qBound(1, qCeil(std::sqrt(count / primitivesPerCell)), maxGridSide);
+    const double cellWidth = qMax(mGridRect.width() / side, sumWidth / count);
+    const double cellHeight = qMax(mGridRect.height() / side, sumHeight / count);
+    mGridCols = (cellWidth > 0) ? qBound(1, qCeil(mGridRect.width() / cellWidth), side) : 1;
+    mGridRows = (cellHeight > 0) ? qBound(1, qCeil(mGridRect.height() / cellHeight), side) : 1;
+    mCellSize = QSizeF(mGridRect.width() / mGridCols, mGridRect.height() / mGridRows);
+    mGridCells.resize(mGridCols * mGridRows);
+    for (int i = 0; i < count; ++i) {
+        if (!mProjRects.at(i).isNull()) {
+            indexPrimitive(i);
+        }
+    }
+}
+
+QRect QGVLayerBatch::gridCells(const QRectF& projRect) const
+{
+    const auto toCell = [](double pos, double origin, double size, int cells) {
+        if (size <= 0) {
+            return 0;
+        }
+        return static_cast<int>(qBound(0.0, std::floor((pos - origin) / size), static_cast<double>(cells - 1)));
+    };
+    const int left = toCell(projRect.left(), mGridRect.left(), mCellSize.width(), mGridCols);
+    const int right = toCell(projRect.right(), mGridRect.left(), mCellSize.width(), mGridCols);
+    const int top = toCell(projRect.top(), mGridRect.top(), mCellSize.height(), mGridRows);
+    const int bottom = toCell(projRect.bottom(), mGridRect.top(), mCellSize.height(), mGridRows);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void QGVLayerBatch::indexPrimitive(int index) const
+{
+    const QRect cells = gridCells(mProjRects.at(index));
+    for (int row = cells.top(); row <= cells.bottom(); ++row) {
+        for (int col = cells.left(); col <= cells.right(); ++col) {
+            mGridCells[row * mGridCols + col].append(index);
+        }
+    }
+}
+
+void QGVLayerBatch::unindexPrimitive(int index, const QRectF& projRect) const
+{
+    const QRect cells = gridCells(projRect);
+    for (int row = cells.top(); row <= cells.bottom(); ++row) {
+        for (int col = cells.left(); col <= cells.right(); ++col) {
+            mGridCells[row * mGridCols + col].removeOne(index);
+        }
+    }
+}
+
+void QGVLayerBatch::paintPrimitives(QPainter* painter)
+{
+    /*
+     * Primitives are culled by visible area and brush is switched only when color changes, so primitives with
+     * same color added together are drawn without extra state changes.
+     */
+    QRectF visibleRect = getMap()->getCamera().projRect();
+    if (painter->hasClipping()) {
+        visibleRect = visibleRect.intersected(painter->clipBoundingRect());
+    }
+    findPrimitives(visibleRect, mVisible);
+    painter->setPen(mPen);
+    QRgb brushColor = 0;
+    bool hasBrush = false;
+    for (int i : mVisible) {
+        const QRectF& projRect = mProjRects.at(i);
+        if (!hasBrush || mColors.at(i) != brushColor) {
+            brushColor = mColors.at(i);
+            painter->setBrush(QColor::fromRgba(brushColor));
+            hasBrush = true;
+        }
+        if (mShapes.at(i) == static_cast<quint8>(Shape::Ellipse)) {
+            painter->drawEllipse(projRect);
+        } else {
+            painter->drawRect(projRect);
+        }
+    }
+
+    if (mSelectedCount == 0) {
+        return;
+    }
+    QPen pen = QPen(getMap()->palette().highlight(), 1, Qt::DashLine);
+    pen.setCosmetic(true);
+    painter->setPen(pen);
+    painter->setBrush(QBrush(getMap()->palette().light().color(), Qt::Dense4Pattern));
+    for (int i : mVisible) {
+        const QRectF& projRect = mProjRects.at(i);
+        if (!mSelected.at(i)) {
+            continue;
+        }
+        if (mShapes.at(i) == static_cast<quint8>(Shape::Ellipse)) {
+            painter->drawEllipse(projRect);
+        } else {
+            painter->drawRect(projRect);
+        }
+    }
+}
+
+void QGVLayerBatch::clickPrimitive(const QPointF& projPos)
+{
+    const int index = primitiveAt(projPos);
+    if (index < 0) {
+        return;
+    }
+    if (getMap()->isMouseAction(QGV::MouseAction::Selection)) {
+        const bool wasSelect = isPrimitiveSelected(index);
+        const Qt::KeyboardModifiers modifiers = QGuiApplication::keyboardModifiers();
+        if (modifiers == Qt::NoModifier) {
+            getMap()->unselectAll();
+            unselectPrimitives();
+            setPrimitiveSelected(index, !wasSelect);
+        }
+        if (modifiers == Qt::ControlModifier || modifiers == Qt::ShiftModifier) {
+            setPrimitiveSelected(index, !wasSelect);
+        }
+    }
+    Q_EMIT primitiveClicked(index);
+}
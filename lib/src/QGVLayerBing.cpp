@@ -22,23 +22,12 @@
 
 namespace {
 // clang-format off
-const QMap<QGV::TilesType, QStringList> URLTemplates = {
-    { QGV::TilesType::Satellite, {
-          "http://t0.tiles.virtualearth.net/tiles/a${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t1.tiles.virtualearth.net/tiles/a${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t2.tiles.virtualearth.net/tiles/a${qk}.jpeg?g=181&mkt=${lcl}",}
-    },
-    { QGV::TilesType::Schema, {
-          "http://t0.tiles.virtualearth.net/tiles/r${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t1.tiles.virtualearth.net/tiles/r${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t2.tiles.virtualearth.net/tiles/r${qk}.jpeg?g=181&mkt=${lcl}",}
-    },
-    { QGV::TilesType::Hybrid, {
-          "http://t0.tiles.virtualearth.net/tiles/h${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t1.tiles.virtualearth.net/tiles/h${qk}.jpeg?g=181&mkt=${lcl}",
-          "http://t2.tiles.virtualearth.net/tiles/h${qk}.jpeg?g=181&mkt=${lcl}",}
-    },
+const QMap<QGV::TilesType, QString> URLTemplates = {
+    { QGV::TilesType::Satellite, "http://t{s}.tiles.virtualearth.net/tiles/a{quadkey}.jpeg?g=181&mkt={lcl}" },
+    { QGV::TilesType::Schema, "http://t{s}.tiles.virtualearth.net/tiles/r{quadkey}.jpeg?g=181&mkt={lcl}" },
+    { QGV::TilesType::Hybrid, "http://t{s}.tiles.virtualearth.net/tiles/h{quadkey}.jpeg?g=181&mkt={lcl}" },
 };
+const QStringList URLSubdomains = { "0", "1", "2" };
 // clang-format on
 }
 
@@ -48,6 +37,7 @@ QGVLayerBing::QGVLayerBing(QGV::TilesType type, QLocale locale, int serverNumber
     , mServerNumber(serverNumber)
 {
     createName();
+    createTemplate();
     setDescription("Copyrights ©Microsoft");
 }
 
@@ -55,12 +45,14 @@ void QGVLayerBing::setType(QGV::TilesType type)
 {
     mType = type;
     createName();
+    createTemplate();
 }
 
 void QGVLayerBing::setLocale(const QLocale& locale)
 {
     mLocale = locale;
     createName();
+    createTemplate();
 }
 
 QGV::TilesType QGVLayerBing::getType() const
@@ -85,6 +77,13 @@ void QGVLayerBing::createName()
     setName("Bing Maps (" + adapter[mType] + " " + mLocale.name() + ")");
 }
 
+void QGVLayerBing::createTemplate()
+{
+    mTemplate = QGVUrlTemplate(URLTemplates[mType], URLSubdomains);
+    mTemplate.setSubdomainIndex(mServerNumber);
+    mTemplate.setVariable("lcl", mLocale.name());
+}
+
 int QGVLayerBing::minZoomlevel() const
 {
     return 1;
@@ -97,9 +96,5 @@ int QGVLayerBing::maxZoomlevel() const
 
 QString QGVLayerBing::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
 {
-    const QStringList& list = URLTemplates[mType];
-    QString url = list.value(mServerNumber).toLower();
-    url.replace("${lcl}", mLocale.name());
-    url.replace("${qk}", tilePos.toQuadKey());
-    return url;
+    return mTemplate.format(tilePos);
 }
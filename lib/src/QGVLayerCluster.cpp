@@ -0,0 +1,444 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerCluster.h"
+#include "QGVDrawItem.h"
+
+#include <QPainter>
+#include <QtMath>
+
+namespace {
+const double symbolPixels = 14.0;
+const int baseZoom = 17;
+}
+
+class QGVLayerCluster::ClusterItem : public QGVDrawItem
+{
+public:
+    explicit ClusterItem(QGVLayerCluster* layer);
+
+    QPainterPath projShape() const override;
+    bool projContains(const QPointF& projPos) const override;
+    void projPaint(QPainter* painter) override;
+    QString projTooltip(const QPointF& projPos) const override;
+    void projOnMouseClick(const QPointF& projPos) override;
+
+private:
+    QGVLayerCluster* mLayer;
+};
+
+QGVLayerCluster::ClusterItem::ClusterItem(QGVLayerCluster* layer)
+    : mLayer(layer)
+{
+    setFlag(QGV::ItemFlag::NoCache);
+    setFlag(QGV::ItemFlag::Clickable);
+    setSelectable(false);
+}
+
+QPainterPath QGVLayerCluster::ClusterItem::projShape() const
+{
+    QPainterPath path;
+    if (getMap() != nullptr) {
+        path.addRect(getMap()->getProjection()->boundaryProjRect());
+    }
+    return path;
+}
+
+bool QGVLayerCluster::ClusterItem::projContains(const QPointF& projPos) const
+{
+    quint64 key;
+    return mLayer->findCluster(projPos, key);
+}
+
+void QGVLayerCluster::ClusterItem::projPaint(QPainter* painter)
+{
+    mLayer->paintClusters(painter);
+}
+
+QString QGVLayerCluster::ClusterItem::projTooltip(const QPointF& projPos) const
+{
+    quint64 key;
+    if (!mLayer->findCluster(projPos, key)) {
+        return {};
+    }
+    return QString("%1 items").arg(mLayer->mLevels.at(mLayer->mCurZoom).value(key).count);
+}
+
+void QGVLayerCluster::ClusterItem::projOnMouseClick(const QPointF& projPos)
+{
+    const QList<QGVDrawItem*> items = mLayer->getClusterItems(projPos);
+    if (!items.isEmpty()) {
+        Q_EMIT mLayer->clusterClicked(items);
+    }
+    QGVDrawItem::projOnMouseClick(projPos);
+}
+
+QGVLayerCluster::QGVLayerCluster()
+    : mItem(new ClusterItem(this))
+    , mFullApply(false)
+    , mCurZoom(-1)
+    , mCellSize(64)
+    , mMaxZoom(16)
+    , mMinClusterSize(2)
+    , mColor(QColor(30, 110, 200))
+{
+    setCameraInterests(QGV::CameraInterest::Scale);
+    mUpdateTimer.setSingleShot(true);
+    mUpdateTimer.setInterval(0);
+    connect(&mUpdateTimer, &QTimer::timeout, this, &QGVLayerCluster::updateClusters);
+    addItem(mItem);
+    mItem->bringToFront();
+}
+
+QGVLayerCluster::~QGVLayerCluster()
+{
+    /*
+     * Items leave index while deleted and layer is notified, so they are deleted before layer data.
+     */
+    deleteItems();
+}
+
+void QGVLayerCluster::setClusterCellSize(int pixels)
+{
+    mCellSize = qMax(1, pixels);
+    rebuildLevels();
+}
+
+int QGVLayerCluster::getClusterCellSize() const
+{
+    return mCellSize;
+}
+
+void QGVLayerCluster::setClusterMaxZoom(int zoom)
+{
+    mMaxZoom = qMax(0, zoom);
+    rebuildLevels();
+}
+
+int QGVLayerCluster::getClusterMaxZoom() const
+{
+    return mMaxZoom;
+}
+
+void QGVLayerCluster::setMinClusterSize(int count)
+{
+    mMinClusterSize = qMax(2, count);
+    mFullApply = true;
+    mUpdateTimer.start();
+}
+
+int QGVLayerCluster::getMinClusterSize() const
+{
+    return mMinClusterSize;
+}
+
+void QGVLayerCluster::setClusterColor(const QColor& color)
+{
+    mColor = color;
+    mItem->repaint();
+}
+
+QColor QGVLayerCluster::getClusterColor() const
+{
+    return mColor;
+}
+
+int QGVLayerCluster::getClusterZoom() const
+{
+    return mCurZoom;
+}
+
+int QGVLayerCluster::countClusters() const
+{
+    if (!isClusterZoom()) {
+        return 0;
+    }
+    int count = 0;
+    for (const Cell& cell : mLevels.at(mCurZoom)) {
+        if (cell.count >= mMinClusterSize) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool QGVLayerCluster::isClustered(QGVDrawItem* item) const
+{
+    return mClustered.contains(item);
+}
+
+QList<QGVDrawItem*> QGVLayerCluster::getClusterItems(const QPointF& projPos) const
+{
+    QList<QGVDrawItem*> result;
+    quint64 key;
+    if (!findCluster(projPos, key)) {
+        return result;
+    }
+    for (QGVDrawItem* item : search(cellRect(mCurZoom, key))) {
+        const auto it = mPositions.constFind(item);
+        if (it != mPositions.constEnd() && cellKey(mCurZoom, it.value()) == key) {
+            result.append(item);
+        }
+    }
+    return result;
+}
+
+void QGVLayerCluster::onProjection(QGVMap* geoMap)
+{
+    /*
+     * Positions are collected again from index, because every item is projected and indexed again.
+     */
+    mPositions.clear();
+    mOrigin = geoMap->getProjection()->boundaryProjRect().topLeft();
+    rebuildLevels();
+    QGVLayer::onProjection(geoMap);
+    mCurZoom = scaleToZoom(geoMap->getCamera().scale());
+}
+
+void QGVLayerCluster::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
+{
+    QGVLayer::onCamera(oldState, newState);
+    const int zoom = scaleToZoom(newState.scale());
+    if (zoom != mCurZoom) {
+        mCurZoom = zoom;
+        mFullApply = true;
+        updateClusters();
+    }
+    mItem->repaint();
+}
+
+void QGVLayerCluster::onIndexChanged()
+{
+    if (!mUpdateTimer.isActive()) {
+        mUpdateTimer.start();
+    }
+}
+
+void QGVLayerCluster::onItemIndexed(QGVDrawItem* item, const QRectF& projRect)
+{
+    if (item == mItem) {
+        return;
+    }
+    const QPointF projPos = projRect.center();
+    const auto it = mPositions.find(item);
+    if (it != mPositions.end()) {
+        if (it.value() == projPos) {
+            return;
+        }
+        addPosition(it.value(), -1);
+        it.value() = projPos;
+    } else {
+        mPositions.insert(item, projPos);
+    }
+    addPosition(projPos, 1);
+}
+
+void QGVLayerCluster::onItemUnindexed(QGVDrawItem* item)
+{
+    const auto it = mPositions.find(item);
+    if (it == mPositions.end()) {
+        return;
+    }
+    addPosition(it.value(), -1);
+    mPositions.erase(it);
+    if (mClustered.contains(item)) {
+        item->setVisible(mClustered.take(item));
+    }
+    mUpdateTimer.start();
+}
+
+void QGVLayerCluster::rebuildLevels()
+{
+    /*
+     * Cell of zoom level has the same size in pixels as at scale selected for this zoom by tile layers.
+     */
+    mLevels.clear();
+    mCellSizes.clear();
+    mLevels.resize(mMaxZoom + 1);
+    for (int zoom = 0; zoom <= mMaxZoom; ++zoom) {
+        mCellSizes.append(mCellSize * qPow(2.0, baseZoom - zoom));
+    }
+    for (const QPointF& projPos : mPositions) {
+        addPosition(projPos, 1);
+    }
+    mFullApply = true;
+    mUpdateTimer.start();
+}
+
+void QGVLayerCluster::updateClusters()
+{
+    mUpdateTimer.stop();
+    if (getMap() == nullptr || mLevels.isEmpty()) {
+        return;
+    }
+    flushIndex();
+
+    QGVMap::UpdateGuard guard(getMap());
+    if (mFullApply || mDirtyCells.size() > mPositions.size() / 4) {
+        for (auto it = mPositions.constBegin(); it != mPositions.constEnd(); ++it) {
+            applyItem(it.key(), it.value());
+        }
+    } else if (isClusterZoom()) {
+        for (quint64 key : mDirtyCells) {
+            for (QGVDrawItem* item : search(cellRect(mCurZoom, key))) {
+                const auto it = mPositions.constFind(item);
+                if (it != mPositions.constEnd() && cellKey(mCurZoom, it.value()) == key) {
+                    applyItem(item, it.value());
+                }
+            }
+        }
+    }
+    mDirtyCells.clear();
+    mFullApply = false;
+    mItem->repaint();
+}
+
+void QGVLayerCluster::addPosition(const QPointF& projPos, int delta)
+{
+    if (mLevels.isEmpty()) {
+        return;
+    }
+    for (int zoom = 0; zoom < mLevels.size(); ++zoom) {
+        const quint64 key = cellKey(zoom, projPos);
+        Cell& cell = mLevels[zoom][key];
+        cell.count += delta;
+        cell.sumX += delta * projPos.x();
+        cell.sumY += delta * projPos.y();
+        if (cell.count <= 0) {
+            mLevels[zoom].remove(key);
+        }
+        if (zoom == mCurZoom) {
+            mDirtyCells.insert(key);
+        }
+    }
+}
+
+void QGVLayerCluster::applyItem(QGVDrawItem* item, const QPointF& projPos)
+{
+    const bool clustered =
+            isClusterZoom() && mLevels.at(mCurZoom).value(cellKey(mCurZoom, projPos)).count >= mMinClusterSize;
+    if (clustered == mClustered.contains(item)) {
+        return;
+    }
+    if (clustered) {
+        mClustered.insert(item, item->isVisible());
+        item->setVisible(false);
+    } else {
+        item->setVisible(mClustered.take(item));
+    }
+}
+
+int QGVLayerCluster::scaleToZoom(double scale) const
+{
+    return qMax(0, qRound(baseZoom + qLn(scale) * M_LOG2E));
+}
+
+quint64 QGVLayerCluster::cellKey(int zoom, const QPointF& projPos) const
+{
+    const double size = mCellSizes.at(zoom);
+    const qint32 x = qFloor((projPos.x() - mOrigin.x()) / size);
+    const qint32 y = qFloor((projPos.y() - mOrigin.y()) / size);
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+QRectF QGVLayerCluster::cellRect(int zoom, quint64 key) const
+{
+    const double size = mCellSizes.at(zoom);
+    const qint32 x = static_cast<qint32>(static_cast<quint32>(key >> 32));
+    const qint32 y = static_cast<qint32>(static_cast<quint32>(key));
+    return QRectF(mOrigin.x() + x * size, mOrigin.y() + y * size, size, size);
+}
+
+bool QGVLayerCluster::isClusterZoom() const
+{
+    return mCurZoom >= 0 && mCurZoom < mLevels.size();
+}
+
+bool QGVLayerCluster::findCluster(const QPointF& projPos, quint64& key) const
+{
+    /*
+     * Symbol is drawn at centroid of cell, so it can overlap neighbour cells.
+     */
+    if (!isClusterZoom() || getMap() == nullptr) {
+        return false;
+    }
+    const double radius = symbolPixels / getMap()->getCamera().scale();
+    const double size = mCellSizes.at(mCurZoom);
+    const auto& cells = mLevels.at(mCurZoom);
+    double bestDistance = radius * radius;
+    bool found = false;
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            const quint64 cellPos = cellKey(mCurZoom, projPos + QPointF(dx * size, dy * size));
+            const auto it = cells.constFind(cellPos);
+            if (it == cells.constEnd() || it->count < mMinClusterSize) {
+                continue;
+            }
+            const QPointF center(it->sumX / it->count, it->sumY / it->count);
+            const QPointF delta = projPos - center;
+            const double distance = delta.x() * delta.x() + delta.y() * delta.y();
+            if (distance <= bestDistance) {
+                bestDistance = distance;
+                key = cellPos;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+void QGVLayerCluster::paintClusters(QPainter* painter)
+{
+    if (!isClusterZoom()) {
+        return;
+    }
+    const QGVCameraState camera = getMap()->getCamera();
+    QRectF visibleRect = camera.projRect();
+    if (painter->hasClipping()) {
+        visibleRect = visibleRect.intersected(painter->clipBoundingRect());
+    }
+    const double scale = 1.0 / camera.scale();
+    const double margin = symbolPixels * scale;
+    visibleRect.adjust(-margin, -margin, margin, margin);
+
+    QFont font = painter->font();
+    font.setPixelSize(11);
+    font.setBold(true);
+    painter->setFont(font);
+    const QPen pen = QPen(QBrush(Qt::white), 2);
+    for (const Cell& cell : mLevels.at(mCurZoom)) {
+        if (cell.count < mMinClusterSize) {
+            continue;
+        }
+        const QPointF center(cell.sumX / cell.count, cell.sumY / cell.count);
+        if (!visibleRect.contains(center)) {
+            continue;
+        }
+        const double radius = qMin(symbolPixels, 8.0 + 2.0 * std::log10(cell.count));
+        painter->save();
+        painter->setTransform(QGV::createTransfrom(center, scale, -camera.azimuth()), true);
+        painter->translate(center);
+        painter->setPen(pen);
+        painter->setBrush(mColor);
+        painter->drawEllipse(QPointF(0, 0), radius, radius);
+        painter->setPen(Qt::white);
+        const QRectF textRect(-radius, -radius, 2 * radius, 2 * radius);
+        painter->drawText(textRect, Qt::AlignCenter, QString::number(cell.count));
+        painter->restore();
+    }
+}
@@ -22,25 +22,15 @@
 
 namespace {
 // clang-format off
-const QMap<QGV::TilesType, QStringList> URLTemplates = {
-    {QGV::TilesType::Satellite, {
-         "https://mts0.google.com/vt/lyrs=s@186112443&hl=${lcl}&x=${x}&y=${y}&z=${z}&s=Galile",
-         "https://mts1.google.com/vt/lyrs=s@186112443&hl=${lcl}&x=${x}&y=${y}&z=${z}&s=Galile",
-         "https://mts2.google.com/vt/lyrs=s@186112443&hl=${lcl}&x=${x}&y=${y}&z=${z}&s=Galile",
-         }
-    },
-    {QGV::TilesType::Schema, {
-         "http://mt1.google.com/vt/lyrs=m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         "http://mt2.google.com/vt/lyrs=m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         "http://mt3.google.com/vt/lyrs=m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         }
-    },
-    {QGV::TilesType::Hybrid, {
-         "http://mt1.google.com/vt/lyrs=s,m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         "http://mt2.google.com/vt/lyrs=s,m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         "http://mt3.google.com/vt/lyrs=s,m@110&hl=${lcl}&x=${x}&y=${y}&z=${z}",
-         }
-    },
+const QMap<QGV::TilesType, QString> URLTemplates = {
+    { QGV::TilesType::Satellite, "https://mts{s}.google.com/vt/lyrs=s@186112443&hl={lcl}&x={x}&y={y}&z={z}&s=Galile" },
+    { QGV::TilesType::Schema, "http://mt{s}.google.com/vt/lyrs=m@110&hl={lcl}&x={x}&y={y}&z={z}" },
+    { QGV::TilesType::Hybrid, "http://mt{s}.google.com/vt/lyrs=s,m@110&hl={lcl}&x={x}&y={y}&z={z}" },
+};
+const QMap<QGV::TilesType, QStringList> URLSubdomains = {
+    { QGV::TilesType::Satellite, { "0", "1", "2" } },
+    { QGV::TilesType::Schema, { "1", "2", "3" } },
+    { QGV::TilesType::Hybrid, { "1", "2", "3" } },
 };
 // clang-format on
 }
@@ -51,6 +41,7 @@ QGVLayerGoogle::QGVLayerGoogle(QGV::TilesType type, QLocale locale, int serverNu
     , mServerNumber(serverNumber)
 {
     createName();
+    createTemplate();
     setDescription("Copyrights ©Google");
 }
 
@@ -58,12 +49,14 @@ void QGVLayerGoogle::setType(QGV::TilesType type)
 {
     mType = type;
     createName();
+    createTemplate();
 }
 
 void QGVLayerGoogle::setLocale(const QLocale& locale)
 {
     mLocale = locale;
     createName();
+    createTemplate();
 }
 
 QGV::TilesType QGVLayerGoogle::getType() const
@@ -88,6 +81,13 @@ void QGVLayerGoogle::createName()
     setName("Google Maps (" + adapter[mType] + " " + mLocale.name() + ")");
 }
 
+void QGVLayerGoogle::createTemplate()
+{
+    mTemplate = QGVUrlTemplate(URLTemplates[mType], URLSubdomains[mType]);
+    mTemplate.setSubdomainIndex(mServerNumber);
+    mTemplate.setVariable("lcl", mLocale.name());
+}
+
 int QGVLayerGoogle::minZoomlevel() const
 {
     return 0;
@@ -100,11 +100,5 @@ int QGVLayerGoogle::maxZoomlevel() const
 
 QString QGVLayerGoogle::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
 {
-    const QStringList& list = URLTemplates[mType];
-    QString url = list.value(mServerNumber).toLower();
-    url.replace("${lcl}", mLocale.name());
-    url.replace("${z}", QString::number(tilePos.zoom()));
-    url.replace("${x}", QString::number(tilePos.pos().x()));
-    url.replace("${y}", QString::number(tilePos.pos().y()));
-    return url;
+    return mTemplate.format(tilePos);
 }
@@ -21,24 +21,20 @@
 #include <QtMath>
 
 namespace {
-// clang-format off
-const QStringList URLTemplates = {
-    "http://a.tile.openstreetmap.org/${z}/${x}/${y}.png",
-    "http://b.tile.openstreetmap.org/${z}/${x}/${y}.png",
-    "http://c.tile.openstreetmap.org/${z}/${x}/${y}.png",
-};
-// clang-format on
+const QString URLTemplate = "http://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png";
+const QStringList URLSubdomains = { "a", "b", "c" };
 }
 
 QGVLayerOSM::QGVLayerOSM(int serverNumber)
-    : mUrl(URLTemplates.value(serverNumber))
+    : mTemplate(URLTemplate, URLSubdomains)
 {
+    mTemplate.setSubdomainIndex(serverNumber);
     setName("OpenStreetMap");
     setDescription("Copyrights ©OpenStreetMap");
 }
 
 QGVLayerOSM::QGVLayerOSM(const QString& url)
-    : mUrl(url)
+    : mTemplate(url, URLSubdomains)
 {
     setName("Custom");
     setDescription("OSM-like map");
@@ -46,12 +42,12 @@ QGVLayerOSM::QGVLayerOSM(const QString& url)
 
 void QGVLayerOSM::setUrl(const QString& url)
 {
-    mUrl = url;
+    mTemplate.setPattern(url);
 }
 
 QString QGVLayerOSM::getUrl() const
 {
-    return mUrl;
+    return mTemplate.getPattern();
 }
 
 int QGVLayerOSM::minZoomlevel() const
@@ -64,11 +60,16 @@ int QGVLayerOSM::maxZoomlevel() const
     return 20;
 }
 
+/*
+ * Tile size above 256 px selects resolution suffix {r}, like "@2x" for 512 px tiles.
+ */
+void QGVLayerOSM::onTileSize(int tileSize)
+{
+    const int ratio = tileSize / 256;
+    mTemplate.setVariable("r", (ratio > 1) ? QString("@%1x").arg(ratio) : QString());
+}
+
 QString QGVLayerOSM::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
 {
-    QString url = mUrl.toLower();
-    url.replace("${z}", QString::number(tilePos.zoom()));
-    url.replace("${x}", QString::number(tilePos.pos().x()));
-    url.replace("${y}", QString::number(tilePos.pos().y()));
-    return url;
+    return mTemplate.format(tilePos);
 }
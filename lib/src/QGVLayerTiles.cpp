@@ -18,13 +18,90 @@
 
 #include "QGVLayerTiles.h"
 #include "QGVDrawItem.h"
+#include "Raster/QGVImage.h"
 
+#include <QTimer>
 #include <QtMath>
 
+#include <algorithm>
+#include <limits>
+
+namespace {
+const int maxFallbackZoomDelta = 8;
+
+using RankedTile = QPair<qreal, QGV::GeoTilePos>;
+
+int imageCacheCost(size_t bytes)
+{
+    const size_t kilobytes = bytes / 1024 + 1;
+    return static_cast<int>(qMin<size_t>(kilobytes, std::numeric_limits<int>::max()));
+}
+
+/*
+ * Horizontal extent of polygon inside band top <= y <= bottom. Extremes of polygon area inside band always lie on
+ * its edges, so clipping edges is enough.
+ */
+bool polygonSpan(const QPolygonF& polygon, qreal top, qreal bottom, qreal& minX, qreal& maxX)
+{
+    bool found = false;
+    for (int i = 0; i < polygon.size(); ++i) {
+        QPointF a = polygon.at(i);
+        QPointF b = polygon.at((i + 1) % polygon.size());
+        if (a.y() > b.y()) {
+            std::swap(a, b);
+        }
+        if (b.y() < top || a.y() > bottom) {
+            continue;
+        }
+        const qreal dy = b.y() - a.y();
+        const auto xAt = [&](qreal y) { return (dy > 0) ? a.x() + (b.x() - a.x()) * (y - a.y()) / dy : a.x(); };
+        const qreal x1 = (a.y() < top) ? xAt(top) : a.x();
+        const qreal x2 = (b.y() > bottom) ? xAt(bottom) : b.x();
+        minX = (found) ? qMin(minX, qMin(x1, x2)) : qMin(x1, x2);
+        maxX = (found) ? qMax(maxX, qMax(x1, x2)) : qMax(x1, x2);
+        found = true;
+    }
+    return found;
+}
+
+/*
+ * Visits row intervals [first, second) of footprint "from" which are not covered by footprint "to".
+ */
+template<typename Visitor>
+void visitSpanDifference(const QRect& fromRect,
+                         const QVector<QPair<int, int>>& fromSpans,
+                         const QRect& toRect,
+                         const QVector<QPair<int, int>>& toSpans,
+                         Visitor visit)
+{
+    for (int y = fromRect.top(); y < fromRect.bottom(); ++y) {
+        const QPair<int, int>& from = fromSpans.at(y - fromRect.top());
+        const int toRow = y - toRect.top();
+        const QPair<int, int> to = (toRow >= 0 && toRow < toSpans.size()) ? toSpans.at(toRow) : qMakePair(0, 0);
+        if (to.first >= to.second) {
+            visit(y, from.first, from.second);
+            continue;
+        }
+        if (from.first < qMin(from.second, to.first)) {
+            visit(y, from.first, qMin(from.second, to.first));
+        }
+        if (qMax(from.first, to.second) < from.second) {
+            visit(y, qMax(from.first, to.second), from.second);
+        }
+    }
+}
+}
+
 QGVLayerTiles::QGVLayerTiles()
+    : mCameraScheduled(false)
+    , mUsageBytes(0)
 {
     mCurZoom = -1;
+    setCameraInterests(QGV::CameraInterest::All);
+    mTileCache.setMaxCost(imageCacheCost(mPerfomanceProfile.TileCacheSize));
+    mUsageClock.start();
     sendToBack();
+    connect(&mMetricsTimer, &QTimer::timeout, this, [this]() { Q_EMIT metricsUpdated(mMetrics); });
 }
 
 void QGVLayerTiles::setTilesMarginWithZoomChange(size_t value)
@@ -63,6 +140,186 @@ void QGVLayerTiles::setCameraUpdatesDuringAnimation(bool value)
     qgvDebug() << "CameraUpdatesDuringAnimation changed to" << value;
 }
 
+void QGVLayerTiles::setTileCacheSize(size_t bytes)
+{
+    mPerfomanceProfile.TileCacheSize = bytes;
+    mTileCache.setMaxCost(imageCacheCost(bytes));
+    qgvDebug() << "TileCacheSize changed to" << bytes;
+}
+
+void QGVLayerTiles::setTileMemoryBudget(size_t bytes)
+{
+    mPerfomanceProfile.TileMemoryBudget = bytes;
+    qgvDebug() << "TileMemoryBudget changed to" << bytes;
+    enforceMemoryBudget();
+}
+
+size_t QGVLayerTiles::getTileMemoryBudget() const
+{
+    return mPerfomanceProfile.TileMemoryBudget;
+}
+
+size_t QGVLayerTiles::getTileMemoryUsage() const
+{
+    return mUsageBytes;
+}
+
+void QGVLayerTiles::setMosaicRendering(bool enabled)
+{
+    if (mPerfomanceProfile.MosaicRendering == enabled) {
+        return;
+    }
+    mPerfomanceProfile.MosaicRendering = enabled;
+    qgvDebug() << "MosaicRendering changed to" << enabled;
+
+    removeAllTiles();
+    mCurZoom = -1;
+    processCamera();
+}
+
+bool QGVLayerTiles::isMosaicRendering() const
+{
+    return mPerfomanceProfile.MosaicRendering;
+}
+
+void QGVLayerTiles::setOverzoomFallback(bool enabled)
+{
+    mPerfomanceProfile.OverzoomFallback = enabled;
+    qgvDebug() << "OverzoomFallback changed to" << enabled;
+}
+
+bool QGVLayerTiles::isOverzoomFallback() const
+{
+    return mPerfomanceProfile.OverzoomFallback;
+}
+
+/*
+ * Pixel size of tile images. Zoom level is selected so tile image pixels match device pixels, so 512 px tiles (or
+ * @2x tiles of 256 px grid) are loaded one zoom level lower than 256 px tiles and need 4x less requests.
+ */
+void QGVLayerTiles::setTileSize(int pixels)
+{
+    pixels = qMax(1, pixels);
+    if (mPerfomanceProfile.TileSize == pixels) {
+        return;
+    }
+    mPerfomanceProfile.TileSize = pixels;
+    qgvDebug() << "TileSize changed to" << pixels;
+    for (const QGV::GeoTilePos& tilePos : mPrefetch) {
+        mMetrics.addCounter(QGVTileMetrics::Counter::Cancelled);
+        cancel(tilePos);
+    }
+    mPrefetch.clear();
+    removeAllTiles();
+    clearTileCache();
+    onTileSize(pixels);
+    mCurZoom = -1;
+    processCamera();
+}
+
+int QGVLayerTiles::getTileSize() const
+{
+    return mPerfomanceProfile.TileSize;
+}
+
+/*
+ * Device pixel ratio used for zoom selection. Default is 1, so zoom does not depend on screen. Zero means ratio of
+ * map widget, which is meant for @2x tiles (setTileSize(512)) to keep them sharp on high density screens.
+ */
+void QGVLayerTiles::setDevicePixelRatio(qreal ratio)
+{
+    ratio = qMax<qreal>(0, ratio);
+    if (qFuzzyCompare(mPerfomanceProfile.DevicePixelRatio + 1, ratio + 1)) {
+        return;
+    }
+    mPerfomanceProfile.DevicePixelRatio = ratio;
+    qgvDebug() << "DevicePixelRatio changed to" << ratio;
+    mCurZoom = -1;
+    processCamera();
+}
+
+qreal QGVLayerTiles::getDevicePixelRatio() const
+{
+    if (mPerfomanceProfile.DevicePixelRatio > 0) {
+        return mPerfomanceProfile.DevicePixelRatio;
+    }
+    return (getMap() != nullptr) ? getMap()->devicePixelRatioF() : 1.0;
+}
+
+quint64 QGVLayerTiles::getTileCacheHits() const
+{
+    return mMetrics.getCounter(QGVTileMetrics::Counter::CacheHits);
+}
+
+quint64 QGVLayerTiles::getTileCacheMisses() const
+{
+    return mMetrics.getCounter(QGVTileMetrics::Counter::CacheMisses);
+}
+
+void QGVLayerTiles::clearTileCache()
+{
+    mTileCache.clear();
+}
+
+const QGVTileMetrics& QGVLayerTiles::getMetrics() const
+{
+    return mMetrics;
+}
+
+void QGVLayerTiles::resetMetrics()
+{
+    mMetrics.clear();
+    mViewportTimer.invalidate();
+    mViewportPending.clear();
+}
+
+void QGVLayerTiles::setMetricsInterval(int msec)
+{
+    if (msec > 0) {
+        mMetricsTimer.start(msec);
+    } else {
+        mMetricsTimer.stop();
+    }
+    qgvDebug() << "MetricsInterval changed to" << msec;
+}
+
+int QGVLayerTiles::getMetricsInterval() const
+{
+    return (mMetricsTimer.isActive()) ? mMetricsTimer.interval() : 0;
+}
+
+void QGVLayerTiles::setTileStore(QGVTileStore* store)
+{
+    mTileStore = store;
+    qgvDebug() << "TileStore changed to" << ((store != nullptr) ? store->getFileName() : QString());
+}
+
+QGVTileStore* QGVLayerTiles::getTileStore() const
+{
+    return mTileStore.data();
+}
+
+void QGVLayerTiles::setLayerId(const QString& layerId)
+{
+    mLayerId = layerId;
+}
+
+QString QGVLayerTiles::getLayerId() const
+{
+    return (!mLayerId.isEmpty()) ? mLayerId : getName();
+}
+
+/*
+ * Layer id for stored and decoded tiles. Tiles of non-default size are kept apart from 256 px tiles.
+ */
+QString QGVLayerTiles::getTileSetId() const
+{
+    if (mPerfomanceProfile.TileSize == 256) {
+        return getLayerId();
+    }
+    return QString("%1@%2").arg(getLayerId()).arg(mPerfomanceProfile.TileSize);
+}
+
 void QGVLayerTiles::onProjection(QGVMap* geoMap)
 {
     QGVLayer::onProjection(geoMap);
@@ -78,13 +335,16 @@ void QGVLayerTiles::onCamera(const QGVCameraState& oldState, const QGVCameraStat
 
     bool needUpdate = true;
 
-    if (newState.animation()) {
-        if (!mPerfomanceProfile.CameraUpdatesDuringAnimation) {
-            needUpdate = false;
-        } else if (!mLastAnimation.isValid()) {
+    const QGV::MapState state = getMap()->getState();
+    const bool interaction = (state == QGV::MapState::Wheel || state == QGV::MapState::MovingMap);
+    if (newState.animation() && !mPerfomanceProfile.CameraUpdatesDuringAnimation) {
+        needUpdate = false;
+    } else if (newState.animation() || interaction) {
+        if (!mLastAnimation.isValid()) {
             mLastAnimation.start();
         } else if (mLastAnimation.elapsed() < static_cast<qint64>(mPerfomanceProfile.AnimationUpdateDelayMs)) {
             needUpdate = false;
+            scheduleCamera();
         } else {
             mLastAnimation.restart();
         }
@@ -93,10 +353,40 @@ void QGVLayerTiles::onCamera(const QGVCameraState& oldState, const QGVCameraStat
     }
 
     if (needUpdate) {
+        mCameraScheduled = false;
         processCamera();
     }
 }
 
+/*
+ * Throttled camera change is not lost: last one is processed when delay expires, even if no more changes come
+ * (e.g. wheel or map moving is already finished).
+ */
+void QGVLayerTiles::scheduleCamera()
+{
+    if (mCameraScheduled) {
+        return;
+    }
+    mCameraScheduled = true;
+    const qint64 delay = static_cast<qint64>(mPerfomanceProfile.AnimationUpdateDelayMs) - mLastAnimation.elapsed();
+    QTimer::singleShot(static_cast<int>(qMax<qint64>(0, delay)), this, [this]() {
+        if (!mCameraScheduled) {
+            return;
+        }
+        mCameraScheduled = false;
+        if (mLastAnimation.isValid()) {
+            mLastAnimation.restart();
+        }
+        processCamera();
+    });
+}
+
+void QGVLayerTiles::onCameraTarget(const QGVCameraActions& target)
+{
+    QGVLayer::onCameraTarget(target);
+    prefetch(target);
+}
+
 void QGVLayerTiles::onUpdate()
 {
     QGVLayer::onUpdate();
@@ -108,35 +398,66 @@ void QGVLayerTiles::onClean()
     QGVLayer::onClean();
     mCurZoom = -1;
     mCurRect = {};
+    mCurSpans.clear();
+    mPrevRect = {};
+    mPrevSpans.clear();
+    for (const QGV::GeoTilePos& tilePos : mPrefetch) {
+        mMetrics.addCounter(QGVTileMetrics::Counter::Cancelled);
+        cancel(tilePos);
+    }
+    mPrefetch.clear();
+    mViewportTimer.invalidate();
+    mViewportPending.clear();
+    mUsage.clear();
+    mUsageBytes = 0;
     mIndex.clear();
+    mMosaics.clear();
+    mFallback.clear();
     deleteItems();
 }
 
 void QGVLayerTiles::onTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
 {
-    if (tilePos.zoom() != mCurZoom || !mCurRect.contains(tilePos.pos())) {
+    const bool prefetched = mPrefetch.remove(tilePos);
+    if (!isTileActive(tilePos)) {
+        if (prefetched) {
+            qgvDebug() << "keep prefetched tile" << tilePos;
+            cacheTile(tilePos, tileObj);
+        }
         delete tileObj;
         return;
     }
+    mMetrics.addCounter(QGVTileMetrics::Counter::Loaded);
     addTile(tilePos, tileObj);
 
     removeAllAbove(tilePos);
 
-    const int fromZoom = minZoomlevel();
-    const int toZoom = tilePos.zoom() - 1;
-    for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
-        for (const QGV::GeoTilePos& below : existingTiles(zoom)) {
-            if (below.contains(tilePos)) {
-                removeWhenCovered(below);
-            }
-        }
+    mIndex.forEachAncestor(tilePos, [this](const QGV::GeoTilePos& below, QGVDrawItem*) { removeWhenCovered(below); });
+    checkViewportComplete(tilePos);
+    enforceMemoryBudget();
+}
+
+void QGVLayerTiles::onTileFailed(const QGV::GeoTilePos& tilePos)
+{
+    mPrefetch.remove(tilePos);
+    mMetrics.addCounter(QGVTileMetrics::Counter::Failed);
+    if (mIndex.state(tilePos) != QGVTilePyramid::TileState::Pending) {
+        return;
     }
+    qgvDebug() << "tile failed" << tilePos;
+    mIndex.setFailed(tilePos);
+    checkViewportComplete(tilePos);
+}
+
+void QGVLayerTiles::onTileSize(int /*tileSize*/)
+{
 }
 
 int QGVLayerTiles::scaleToZoom(double scale) const
 {
     const double scaleChange = 1 / scale;
-    const int newZoom = qRound((17.0 - qLn(scaleChange) * M_LOG2E));
+    const double pixelChange = getDevicePixelRatio() * 256.0 / mPerfomanceProfile.TileSize;
+    const int newZoom = qRound((17.0 - qLn(scaleChange) * M_LOG2E + qLn(pixelChange) * M_LOG2E));
     return newZoom;
 }
 
@@ -145,10 +466,7 @@ void QGVLayerTiles::processCamera()
     if (getMap() == nullptr || !isVisible()) {
         return;
     }
-    const QGVProjection* projection = getMap()->getProjection();
     const QGVCameraState camera = getMap()->getCamera();
-    const QRectF areaProjRect = camera.projRect().intersected(projection->boundaryProjRect());
-    const QGV::GeoRect areaGeoRect = projection->projToGeo(areaProjRect);
 
     int originZoom = scaleToZoom(camera.scale());
     int newZoom = qMin(maxZoomlevel(), qMax(minZoomlevel(), originZoom));
@@ -161,113 +479,354 @@ void QGVLayerTiles::processCamera()
 
     const int margin = (zoomChanged) ? static_cast<int>(mPerfomanceProfile.TilesMarginWithZoomChange)
                                      : static_cast<int>(mPerfomanceProfile.TilesMarginNoZoomChange);
-    const int sizePerZoom = static_cast<int>(qPow(2, mCurZoom));
-    const QRect maxRect = QRect(QPoint(0, 0), QPoint(sizePerZoom, sizePerZoom));
-    const QPoint topLeft = QGV::GeoTilePos::geoToTilePos(mCurZoom, areaGeoRect.topLeft()).pos();
-    const QPoint bottomRight = QGV::GeoTilePos::geoToTilePos(mCurZoom, areaGeoRect.bottomRight()).pos();
-    QRect activeRect = QRect(topLeft, bottomRight);
-    activeRect = activeRect.adjusted(-margin, -margin, margin, margin);
-    activeRect = activeRect.intersected(maxRect);
-    const bool rectChanged = (!zoomChanged && (mCurRect != activeRect));
-    mCurRect = activeRect;
+    const QGV::GeoRect tileGeoRect = QGV::GeoTilePos(mCurZoom, QPoint(0, 0)).toGeoRect();
+    const QGVProjection* projection = getMap()->getProjection();
+    mTileOrigin = projection->geoToProj(tileGeoRect.topLeft());
+    mTileStep = projection->geoToProj(tileGeoRect.bottomRight()) - mTileOrigin;
+
+    const QPolygonF areaProjPolygon = camera.projPolygon();
+    const QRectF areaProjRect = areaProjPolygon.boundingRect();
+    mCurView = QRectF(projToTile(areaProjRect.topLeft()), projToTile(areaProjRect.bottomRight())).normalized();
+    mPrevRect = mCurRect;
+    mPrevSpans.swap(mCurSpans);
+    mCurRect = tileFootprint(mCurZoom, areaProjPolygon, margin, mCurSpans);
+    const bool rectChanged = (!zoomChanged && (mCurRect != mPrevRect || mCurSpans != mPrevSpans));
 
     if (!zoomChanged && !rectChanged) {
+        reprioritize();
         return;
     }
+    if (!mViewportTimer.isValid()) {
+        mViewportTimer.start();
+    }
 
     if (zoomChanged) {
         qgvDebug() << "new active zoom" << mCurZoom;
-        const int fromZoom = minZoomlevel();
-        const int toZoom = maxZoomlevel();
-        for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
-            if (zoom == mCurZoom) {
-                for (const QGV::GeoTilePos& current : existingTiles(zoom)) {
-                    removeAllAbove(current);
-                }
-            } else {
-                for (const QGV::GeoTilePos& nonCurrent : existingTiles(zoom)) {
-                    if (!isTileFinished(nonCurrent)) {
-                        qgvDebug() << "cancel non-finished" << nonCurrent;
-                        removeTile(nonCurrent);
-                    } else if (zoom < mCurZoom) {
-                        removeWhenCovered(nonCurrent);
-                    }
-                    removeForPerfomance(nonCurrent);
+        /*
+         * Full scan: tiles of new zoom may be left from earlier visit to it anywhere outside current footprint,
+         * while later rect changes only remove strips which left previous footprint.
+         */
+        mIndex.collect(mScratch);
+        for (const QGV::GeoTilePos& tilePos : mScratch) {
+            if (!isTileExists(tilePos)) {
+                continue;
+            }
+            if (tilePos.zoom() == mCurZoom) {
+                if (!isTileActive(tilePos) && !mPrefetch.contains(tilePos)) {
+                    qgvDebug() << "delete out of boundary view" << tilePos;
+                    removeTile(tilePos);
+                    continue;
                 }
+                removeAllAbove(tilePos);
+                continue;
+            }
+            if (!isTileFinished(tilePos)) {
+                qgvDebug() << "cancel non-finished" << tilePos;
+                removeTile(tilePos);
+                continue;
+            }
+            if (tilePos.zoom() < mCurZoom) {
+                removeWhenCovered(tilePos);
+            }
+            if (isTileExists(tilePos)) {
+                removeForPerfomance(tilePos);
             }
         }
     }
 
+    mMissing.clear();
+    const auto addMissing = [this, rectChanged](int y, int first, int second) {
+        for (int x = first; x < second; ++x) {
+            const auto tilePos = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
+            const auto state = mIndex.state(tilePos);
+            if (state == QGVTilePyramid::TileState::Pending || state == QGVTilePyramid::TileState::Loaded) {
+                continue;
+            }
+            if (rectChanged && state == QGVTilePyramid::TileState::Failed) {
+                continue;
+            }
+            mMissing.append(qMakePair(getTilePriority(tilePos), tilePos));
+        }
+    };
+
     if (rectChanged) {
         qgvDebug() << "new active rect" << mCurRect.topLeft() << mCurRect.bottomRight();
-        for (const QGV::GeoTilePos& tilePos : existingTiles(mCurZoom)) {
-            if (!mCurRect.contains(tilePos.pos())) {
-                qgvDebug() << "delete out of boundary view" << tilePos;
-                removeTile(tilePos);
+        visitSpanDifference(mPrevRect, mPrevSpans, mCurRect, mCurSpans, [this](int y, int first, int second) {
+            for (int x = first; x < second; ++x) {
+                const auto tilePos = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
+                if (isTileExists(tilePos)) {
+                    qgvDebug() << "delete out of boundary view" << tilePos;
+                    removeTile(tilePos);
+                }
+            }
+        });
+        visitSpanDifference(mCurRect, mCurSpans, mPrevRect, mPrevSpans, addMissing);
+        /*
+         * Failed tiles of whole footprint are requested again, as full scan does, so tiles blocked by negative
+         * cache or open circuit are loaded once online layer lets them through.
+         */
+        mIndex.collectFailed(mCurZoom, mScratch);
+        for (const QGV::GeoTilePos& tilePos : mScratch) {
+            if (isTileActive(tilePos)) {
+                mMissing.append(qMakePair(getTilePriority(tilePos), tilePos));
             }
         }
+    } else {
+        for (int y = mCurRect.top(); y < mCurRect.bottom(); ++y) {
+            const QPair<int, int>& span = mCurSpans.at(y - mCurRect.top());
+            addMissing(y, span.first, span.second);
+        }
     }
+    std::sort(mMissing.begin(), mMissing.end(), [](const RankedTile& a, const RankedTile& b) {
+        return a.first < b.first;
+    });
 
-    QMultiMap<qreal, QGV::GeoTilePos> missing;
-    for (int x = mCurRect.left(); x < mCurRect.right(); ++x) {
-        for (int y = mCurRect.top(); y < mCurRect.bottom(); ++y) {
+    const auto missing = mMissing;
+    for (const auto& item : missing) {
+        addTile(item.second, nullptr);
+    }
+    reprioritize();
+    trackViewport();
+    enforceMemoryBudget();
+}
+
+void QGVLayerTiles::reprioritize()
+{
+}
+
+void QGVLayerTiles::requestFailed()
+{
+    if (getMap() == nullptr) {
+        return;
+    }
+    mIndex.collectFailed(mCurZoom, mScratch);
+    const auto failed = mScratch;
+    for (const QGV::GeoTilePos& tilePos : failed) {
+        if (isTileActive(tilePos)) {
+            addTile(tilePos, nullptr);
+        }
+    }
+}
+
+/*
+ * Rasterizes viewport polygon into tile grid of current zoom. Every row of result gets span [first, second) of
+ * columns touched by polygon within margin rows, widened by margin columns. Result rectangle keeps legacy layout:
+ * columns and rows are iterated up to right() and bottom() exclusively.
+ */
+QRect QGVLayerTiles::tileFootprint(int zoom,
+                                   const QPolygonF& areaProjPolygon,
+                                   int margin,
+                                   QVector<QPair<int, int>>& spans) const
+{
+    spans.clear();
+    if (qFuzzyIsNull(mTileStep.x()) || qFuzzyIsNull(mTileStep.y()) || areaProjPolygon.isEmpty()) {
+        return {};
+    }
+    QPolygonF tilePolygon;
+    tilePolygon.reserve(areaProjPolygon.size());
+    for (const QPointF& projPos : areaProjPolygon) {
+        tilePolygon.append(projToTile(projPos));
+    }
+
+    const int sizePerZoom = 1 << zoom;
+    const auto toCell = [sizePerZoom](qreal value) { return qFloor(qBound<qreal>(-1, value, sizePerZoom + 1)); };
+    const QRectF bounds = tilePolygon.boundingRect();
+    const int top = qMax(0, toCell(bounds.top()) - margin);
+    const int bottom = qMin(sizePerZoom, toCell(bounds.bottom()) + margin);
+    if (top >= bottom) {
+        return {};
+    }
+    int left = sizePerZoom;
+    int right = 0;
+    spans.reserve(bottom - top);
+    for (int y = top; y < bottom; ++y) {
+        qreal minX = 0;
+        qreal maxX = 0;
+        QPair<int, int> span(0, 0);
+        if (polygonSpan(tilePolygon, y - margin, y + 1 + margin, minX, maxX)) {
+            span.first = qMax(0, toCell(minX) - margin);
+            span.second = qMin(sizePerZoom, toCell(maxX) + margin);
+        }
+        if (span.first < span.second) {
+            left = qMin(left, span.first);
+            right = qMax(right, span.second);
+        } else {
+            span = qMakePair(0, 0);
+        }
+        spans.append(span);
+    }
+    if (left >= right) {
+        spans.clear();
+        return {};
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+/*
+ * Measures time from camera change till every tile under viewport (margin excluded) is loaded or failed.
+ * Awaited tiles are collected once per camera change and dropped one by one as they finish.
+ */
+void QGVLayerTiles::trackViewport()
+{
+    mViewportPending.clear();
+    if (!mViewportTimer.isValid()) {
+        return;
+    }
+    const int top = qMax(mCurRect.top(), qFloor(mCurView.top()));
+    const int bottom = qMin(mCurRect.bottom() - 1, qFloor(mCurView.bottom()));
+    for (int y = top; y <= bottom; ++y) {
+        const QPair<int, int>& span = mCurSpans.at(y - mCurRect.top());
+        const int right = qMin(span.second - 1, qFloor(mCurView.right()));
+        for (int x = qMax(span.first, qFloor(mCurView.left())); x <= right; ++x) {
             const auto tilePos = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
-            if (isTileExists(tilePos)) {
-                continue;
+            const auto state = mIndex.state(tilePos);
+            if (state == QGVTilePyramid::TileState::Missing || state == QGVTilePyramid::TileState::Pending) {
+                mViewportPending.insert(tilePos);
             }
-            qreal radius = qSqrt(qPow(x - mCurRect.center().x(), 2) + qPow(y - mCurRect.center().y(), 2));
-            missing.insert(radius, tilePos);
         }
     }
+    if (mViewportPending.isEmpty()) {
+        mMetrics.addSample(QGVTileMetrics::Timing::ViewportComplete, mViewportTimer.elapsed());
+        mViewportTimer.invalidate();
+    }
+}
 
-    for (const QGV::GeoTilePos& tilePos : missing) {
-        addTile(tilePos, nullptr);
+void QGVLayerTiles::checkViewportComplete(const QGV::GeoTilePos& tilePos)
+{
+    if (!mViewportTimer.isValid() || !mViewportPending.remove(tilePos) || !mViewportPending.isEmpty()) {
+        return;
     }
+    mMetrics.addSample(QGVTileMetrics::Timing::ViewportComplete, mViewportTimer.elapsed());
+    mViewportTimer.invalidate();
 }
 
-void QGVLayerTiles::removeAllAbove(const QGV::GeoTilePos& tilePos)
+QPointF QGVLayerTiles::projToTile(const QPointF& projPos) const
+{
+    const QPointF delta = projPos - mTileOrigin;
+    return QPointF(delta.x() / mTileStep.x(), delta.y() / mTileStep.y());
+}
+
+bool QGVLayerTiles::isTileActive(const QGV::GeoTilePos& tilePos) const
 {
-    const int fromZoom = tilePos.zoom() + 1;
-    const int toZoom = maxZoomlevel();
-    for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
-        for (const QGV::GeoTilePos& target : existingTiles(zoom)) {
-            if (!tilePos.contains(target)) {
+    if (tilePos.zoom() != mCurZoom) {
+        return false;
+    }
+    const int row = tilePos.pos().y() - mCurRect.top();
+    if (row < 0 || row >= mCurSpans.size()) {
+        return false;
+    }
+    const QPair<int, int>& span = mCurSpans.at(row);
+    return tilePos.pos().x() >= span.first && tilePos.pos().x() < span.second;
+}
+
+qreal QGVLayerTiles::getTilePriority(const QGV::GeoTilePos& tilePos) const
+{
+    if (getMap() == nullptr) {
+        return std::numeric_limits<qreal>::max();
+    }
+    if (tilePos.zoom() != mCurZoom) {
+        if (!mPrefetch.contains(tilePos)) {
+            return std::numeric_limits<qreal>::max();
+        }
+        const QRectF tileProjRect = getMap()->getProjection()->geoToProj(tilePos.toGeoRect());
+        const QPointF delta = tileProjRect.center() - mPrefetchCenter;
+        return qSqrt(QPointF::dotProduct(delta, delta)) / tileProjRect.width();
+    }
+    const QRectF tileRect(tilePos.pos(), QSizeF(1, 1));
+    const QPointF delta = tileRect.center() - mCurView.center();
+    const qreal distance = qSqrt(QPointF::dotProduct(delta, delta));
+    if (tileRect.intersects(mCurView)) {
+        return distance;
+    }
+    return distance + mCurRect.width() + mCurRect.height();
+}
+
+void QGVLayerTiles::prefetch(const QGVCameraActions& target)
+{
+    const auto previous = mPrefetch;
+    mPrefetch.clear();
+    for (const QGV::GeoTilePos& tilePos : previous) {
+        if (!isTileExists(tilePos)) {
+            mMetrics.addCounter(QGVTileMetrics::Counter::Cancelled);
+            cancel(tilePos);
+        }
+    }
+
+    if (getMap() == nullptr || !isVisible()) {
+        return;
+    }
+    const int zoom = scaleToZoom(target.scale());
+    if (zoom < minZoomlevel() || zoom > maxZoomlevel()) {
+        return;
+    }
+    const QGVProjection* projection = getMap()->getProjection();
+    const QGVCameraState camera = getMap()->getCamera();
+    QRectF targetProjRect(QPointF(), camera.projRect().size() * (camera.scale() / target.scale()));
+    targetProjRect.moveCenter(target.projCenter());
+    targetProjRect = targetProjRect.intersected(projection->boundaryProjRect());
+    const QGV::GeoRect targetGeoRect = projection->projToGeo(targetProjRect);
+
+    const int sizePerZoom = static_cast<int>(qPow(2, zoom));
+    const QPoint topLeft = QGV::GeoTilePos::geoToTilePos(zoom, targetGeoRect.topLeft()).pos();
+    const QPoint bottomRight = QGV::GeoTilePos::geoToTilePos(zoom, targetGeoRect.bottomRight()).pos();
+    const QRect targetRect = QRect(topLeft, bottomRight).intersected(QRect(0, 0, sizePerZoom, sizePerZoom));
+
+    mPrefetchCenter = target.projCenter();
+    for (int x = targetRect.left(); x <= targetRect.right(); ++x) {
+        for (int y = targetRect.top(); y <= targetRect.bottom(); ++y) {
+            const auto tilePos = QGV::GeoTilePos(zoom, QPoint(x, y));
+            if (isTileExists(tilePos) || mTileCache.contains(tilePos)) {
                 continue;
             }
-            qgvDebug() << "remove" << target << "above" << tilePos;
-            removeTile(target);
+            qgvDebug() << "prefetch tile" << tilePos;
+            mMetrics.addCounter(QGVTileMetrics::Counter::Requested);
+            mPrefetch.insert(tilePos);
+            request(tilePos);
         }
     }
 }
 
+void QGVLayerTiles::removeAllAbove(const QGV::GeoTilePos& tilePos)
+{
+    mIndex.takeDescendants(tilePos, [this, &tilePos](const QGV::GeoTilePos& target, QGVDrawItem* tileObj) {
+        qgvDebug() << "remove" << target << "above" << tilePos;
+        releaseTile(target, tileObj);
+    });
+}
+
 void QGVLayerTiles::removeWhenCovered(const QGV::GeoTilePos& tilePos)
 {
-    const int zoomDelta = mCurZoom - tilePos.zoom() + 1;
-    const int neededCount = static_cast<int>(qPow(2, zoomDelta));
-    int count = neededCount;
-    for (const QGV::GeoTilePos& current : existingTiles(mCurZoom)) {
-        if (!tilePos.contains(current)) {
-            continue;
-        }
-        if (!isTileFinished(current)) {
-            break;
-        }
-        count--;
-        if (count == 0) {
-            break;
-        }
+    const int zoomDelta = mCurZoom - tilePos.zoom();
+    if (zoomDelta <= 0) {
+        return;
+    }
+    const int side = 1 << zoomDelta;
+    const QRect coverRect = QRect(tilePos.pos() * side, QSize(side, side));
+    int neededCount = 0;
+    for (int y = qMax(coverRect.top(), mCurRect.top()); y <= coverRect.bottom() && y < mCurRect.bottom(); ++y) {
+        const QPair<int, int>& span = mCurSpans.at(y - mCurRect.top());
+        neededCount += qMax(0, qMin(span.second, coverRect.right() + 1) - qMax(span.first, coverRect.left()));
     }
-    if (count == 0) {
+    int count = 0;
+    mIndex.forEachDescendant(tilePos, mCurZoom, [&](const QGV::GeoTilePos& current, QGVDrawItem* tileObj) {
+        if (current.zoom() == mCurZoom && tileObj != nullptr && isTileActive(current)) {
+            count++;
+        }
+    });
+    if (neededCount > 0 && count == neededCount) {
         qgvDebug() << tilePos << "deleted by 100% coverage";
         removeTile(tilePos);
     } else {
-        qgvDebug() << tilePos << "covered" << neededCount - count << "/" << neededCount;
+        qgvDebug() << tilePos << "covered" << count << "/" << neededCount;
     }
 }
 
 void QGVLayerTiles::removeForPerfomance(const QGV::GeoTilePos& tilePos)
 {
-    const auto minZoom = mCurZoom - static_cast<int>(mPerfomanceProfile.VisibleZoomLayersBelowCurrent);
+    const auto zoomsBelow = (mPerfomanceProfile.OverzoomFallback)
+                                    ? 0
+                                    : static_cast<int>(mPerfomanceProfile.VisibleZoomLayersBelowCurrent);
+    const auto minZoom = mCurZoom - zoomsBelow;
     const auto maxZoom = mCurZoom + static_cast<int>(mPerfomanceProfile.VisibleZoomLayersAboveCurrent);
 
     if (tilePos.zoom() < minZoom || tilePos.zoom() > maxZoom) {
@@ -283,43 +842,277 @@ void QGVLayerTiles::addTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj
         return;
     }
     if (tileObj == nullptr) {
-        qgvDebug() << "request tile" << tilePos;
-        mIndex[tilePos.zoom()][tilePos] = nullptr;
-        request(tilePos);
+        mIndex.insert(tilePos, nullptr);
+        if (mPrefetch.contains(tilePos)) {
+            qgvDebug() << "wait for prefetched tile" << tilePos;
+            addFallback(tilePos);
+            return;
+        }
+        QGVDrawItem* cached = takeCachedTile(tilePos);
+        if (cached != nullptr) {
+            qgvDebug() << "reuse cached tile" << tilePos;
+            onTile(tilePos, cached);
+        } else {
+            qgvDebug() << "request tile" << tilePos;
+            mMetrics.addCounter(QGVTileMetrics::Counter::Requested);
+            addFallback(tilePos);
+            request(tilePos);
+        }
     } else {
         qgvDebug() << "add tile" << tilePos;
-        mIndex[tilePos.zoom()][tilePos] = tileObj;
-        tileObj->setZValue(static_cast<qint16>(tilePos.zoom()));
-        addItem(tileObj);
+        const QGVImage* imageTile = qobject_cast<QGVImage*>(tileObj);
+        const size_t bytes = (imageTile != nullptr) ? static_cast<size_t>(imageTile->getImage().sizeInBytes()) : 0;
+        mUsage.insert(tilePos, TileUsage{ bytes, mUsageClock.elapsed() });
+        mUsageBytes += bytes;
+        if (mPerfomanceProfile.MosaicRendering && imageTile != nullptr && imageTile->isImage()) {
+            QGVTileMosaic* mosaic = getMosaic(tilePos.zoom());
+            mosaic->setTile(tilePos, imageTile->getImage());
+            delete tileObj;
+            mIndex.insert(tilePos, mosaic);
+        } else {
+            mIndex.insert(tilePos, tileObj);
+            tileObj->setZValue(static_cast<qint16>(tilePos.zoom()));
+            addItem(tileObj);
+        }
+        removeFallback(tilePos);
+    }
+}
+
+void QGVLayerTiles::removeAllTiles()
+{
+    mIndex.collect(mScratch);
+    const auto tiles = mScratch;
+    for (const QGV::GeoTilePos& tilePos : tiles) {
+        removeTile(tilePos);
     }
 }
 
 void QGVLayerTiles::removeTile(const QGV::GeoTilePos& tilePos)
 {
-    const auto tile = mIndex[tilePos.zoom()].take(tilePos);
-    if (tile == nullptr) {
+    releaseTile(tilePos, mIndex.take(tilePos));
+}
+
+void QGVLayerTiles::releaseTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
+{
+    if (tileObj == nullptr) {
         qgvDebug() << "cancel tile" << tilePos;
+        mMetrics.addCounter(QGVTileMetrics::Counter::Cancelled);
+        mPrefetch.remove(tilePos);
+        removeFallback(tilePos);
         cancel(tilePos);
     } else {
         qgvDebug() << "remove tile" << tilePos;
-        delete tile;
+        mUsageBytes -= mUsage.take(tilePos).bytes;
+        cacheTile(tilePos, tileObj);
+        QGVTileMosaic* mosaic = qobject_cast<QGVTileMosaic*>(tileObj);
+        if (mosaic == nullptr) {
+            delete tileObj;
+            return;
+        }
+        mosaic->removeTile(tilePos);
+        if (mosaic->isEmpty()) {
+            mMosaics.remove(mosaic->getZoom());
+            delete mosaic;
+        }
     }
 }
 
-bool QGVLayerTiles::isTileExists(const QGV::GeoTilePos& tilePos) const
+/*
+ * Evicts tiles by cost until layer fits budget. Tiles of current footprint, tiles under view (lower zoom tiles
+ * still fill it while current ones are pending) and prefetched tiles are kept.
+ */
+void QGVLayerTiles::enforceMemoryBudget()
 {
-    return mIndex[tilePos.zoom()].contains(tilePos);
+    const size_t budget = mPerfomanceProfile.TileMemoryBudget;
+    if (budget == 0 || mUsageBytes <= budget) {
+        return;
+    }
+    const qint64 now = mUsageClock.elapsed();
+    QVector<QPair<qreal, QGV::GeoTilePos>> candidates;
+    candidates.reserve(mUsage.size());
+    for (auto it = mUsage.begin(); it != mUsage.end(); ++it) {
+        if (isTileActive(it.key()) || mPrefetch.contains(it.key()) || tileViewRect(it.key()).intersects(mCurView)) {
+            it->lastVisible = now;
+            continue;
+        }
+        candidates.append(qMakePair(getEvictionCost(it.key(), it->lastVisible, now), it.key()));
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const RankedTile& a, const RankedTile& b) {
+        return a.first > b.first;
+    });
+    for (const auto& candidate : candidates) {
+        if (mUsageBytes <= budget) {
+            break;
+        }
+        if (!isTileFinished(candidate.second)) {
+            continue;
+        }
+        qgvDebug() << "delete because of memory budget" << candidate.second << "cost" << candidate.first;
+        removeTile(candidate.second);
+    }
 }
 
-bool QGVLayerTiles::isTileFinished(const QGV::GeoTilePos& tilePos) const
+/*
+ * Cost of keeping tile out of view: grows with zoom distance to current level and with time since tile was visible
+ * last time (one point per 30 seconds).
+ */
+qreal QGVLayerTiles::getEvictionCost(const QGV::GeoTilePos& tilePos, qint64 lastVisible, qint64 now) const
 {
-    if (!isTileExists(tilePos)) {
-        return false;
+    const qreal age = static_cast<qreal>(now - lastVisible) / 30000.0;
+    return qAbs(mCurZoom - tilePos.zoom()) + age;
+}
+
+QRectF QGVLayerTiles::tileViewRect(const QGV::GeoTilePos& tilePos) const
+{
+    const qreal factor = qPow(2.0, mCurZoom - tilePos.zoom());
+    return QRectF(QPointF(tilePos.pos()) * factor, QSizeF(factor, factor));
+}
+
+QGVTileMosaic* QGVLayerTiles::getMosaic(int zoom)
+{
+    QGVTileMosaic*& mosaic = mMosaics[zoom];
+    if (mosaic == nullptr) {
+        mosaic = new QGVTileMosaic(zoom);
+        mosaic->setZValue(static_cast<qint16>(zoom));
+        addItem(mosaic);
+    }
+    return mosaic;
+}
+
+void QGVLayerTiles::addFallback(const QGV::GeoTilePos& tilePos)
+{
+    if (!mPerfomanceProfile.OverzoomFallback || mFallback.contains(tilePos)) {
+        return;
+    }
+    const QImage image = findAncestorImage(tilePos);
+    if (image.isNull()) {
+        return;
+    }
+    qgvDebug() << "fallback for tile" << tilePos;
+    if (mPerfomanceProfile.MosaicRendering) {
+        QGVTileMosaic* mosaic = getMosaic(tilePos.zoom());
+        mosaic->setTile(tilePos, image);
+        mFallback.insert(tilePos, mosaic);
+        return;
+    }
+    auto tile = new QGVImage();
+    tile->setGeometry(tilePos.toGeoRect());
+    tile->loadImage(image);
+    tile->setProperty("drawDebug",
+                      QString("fallback\ntile(%1,%2,%3)")
+                              .arg(tilePos.zoom())
+                              .arg(tilePos.pos().x())
+                              .arg(tilePos.pos().y()));
+    tile->setZValue(static_cast<qint16>(tilePos.zoom()));
+    addItem(tile);
+    mFallback.insert(tilePos, tile);
+}
+
+void QGVLayerTiles::removeFallback(const QGV::GeoTilePos& tilePos)
+{
+    QGVDrawItem* fallback = mFallback.take(tilePos);
+    if (fallback == nullptr) {
+        return;
+    }
+    QGVTileMosaic* mosaic = qobject_cast<QGVTileMosaic*>(fallback);
+    if (mosaic == nullptr) {
+        delete fallback;
+        return;
+    }
+    if (mIndex.item(tilePos) == mosaic) {
+        return;
+    }
+    mosaic->removeTile(tilePos);
+    if (mosaic->isEmpty()) {
+        mMosaics.remove(mosaic->getZoom());
+        delete mosaic;
+    }
+}
+
+QImage QGVLayerTiles::findAncestorImage(const QGV::GeoTilePos& tilePos)
+{
+    const int minZoom = qMax(minZoomlevel(), tilePos.zoom() - maxFallbackZoomDelta);
+    for (int zoom = tilePos.zoom() - 1; zoom >= minZoom; --zoom) {
+        const QGV::GeoTilePos ancestor = tilePos.parent(zoom);
+        QImage image = tileImage(ancestor, mIndex.item(ancestor));
+        if (image.isNull()) {
+            const QImage* cached = mTileCache.object(ancestor);
+            if (cached != nullptr) {
+                image = *cached;
+            }
+        }
+        if (image.isNull()) {
+            continue;
+        }
+        const int factor = 1 << (tilePos.zoom() - zoom);
+        const QSize size(image.width() / factor, image.height() / factor);
+        if (size.isEmpty()) {
+            return {};
+        }
+        const QPoint cell(tilePos.pos().x() - ancestor.pos().x() * factor,
+                          tilePos.pos().y() - ancestor.pos().y() * factor);
+        return image.copy(QRect(QPoint(cell.x() * size.width(), cell.y() * size.height()), size));
+    }
+    return {};
+}
+
+QImage QGVLayerTiles::tileImage(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj) const
+{
+    const QGVImage* imageTile = qobject_cast<QGVImage*>(tileObj);
+    if (imageTile != nullptr) {
+        return imageTile->getImage();
+    }
+    const QGVTileMosaic* mosaic = qobject_cast<QGVTileMosaic*>(tileObj);
+    if (mosaic != nullptr) {
+        return mosaic->getTile(tilePos);
     }
-    return mIndex[tilePos.zoom()][tilePos] != nullptr;
+    return {};
 }
 
-QList<QGV::GeoTilePos> QGVLayerTiles::existingTiles(int zoom) const
+void QGVLayerTiles::cacheTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
+{
+    const QImage image = tileImage(tilePos, tileObj);
+    if (image.isNull()) {
+        return;
+    }
+    mTileCache.insert(tilePos, new QImage(image), imageCacheCost(static_cast<size_t>(image.sizeInBytes())));
+}
+
+QGVDrawItem* QGVLayerTiles::takeCachedTile(const QGV::GeoTilePos& tilePos)
+{
+    QScopedPointer<QImage> image(mTileCache.take(tilePos));
+    if (image.isNull()) {
+        mMetrics.addCounter(QGVTileMetrics::Counter::CacheMisses);
+        return nullptr;
+    }
+    mMetrics.addCounter(QGVTileMetrics::Counter::CacheHits);
+    auto tile = new QGVImage();
+    tile->setGeometry(tilePos.toGeoRect());
+    tile->loadImage(*image);
+    tile->setProperty("drawDebug",
+                      QString("cache\ntile(%1,%2,%3)")
+                              .arg(tilePos.zoom())
+                              .arg(tilePos.pos().x())
+                              .arg(tilePos.pos().y()));
+    return tile;
+}
+
+QGVTilePyramid::TileState QGVLayerTiles::getTileState(const QGV::GeoTilePos& tilePos) const
+{
+    return mIndex.state(tilePos);
+}
+
+QGVTileMetrics& QGVLayerTiles::metrics()
+{
+    return mMetrics;
+}
+
+bool QGVLayerTiles::isTileExists(const QGV::GeoTilePos& tilePos) const
+{
+    return mIndex.contains(tilePos);
+}
+
+bool QGVLayerTiles::isTileFinished(const QGV::GeoTilePos& tilePos) const
 {
-    return mIndex[zoom].keys();
+    return mIndex.item(tilePos) != nullptr;
 }
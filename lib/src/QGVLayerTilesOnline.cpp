@@ -19,16 +19,187 @@
 #include "QGVLayerTilesOnline.h"
 #include "Raster/QGVImage.h"
 
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+const int defaultMaxRequestsInFlight = 6;
+const int defaultMaxRetries = 3;
+const int retryBaseDelayMs = 500;
+const int retryMaxDelayMs = 30000;
+const int negativeCacheMs = 60000;
+const int negativeCacheLimit = 4096;
+const int circuitFailureThreshold = 5;
+const int circuitOpenMs = 30000;
+
+bool isPermanentError(QNetworkReply::NetworkError error)
+{
+    return error == QNetworkReply::ContentNotFoundError || error == QNetworkReply::ContentGoneError ||
+           error == QNetworkReply::ContentAccessDenied || error == QNetworkReply::ContentOperationNotPermittedError;
+}
+}
+
+QGVLayerTilesOnline::QGVLayerTilesOnline()
+    : mMaxRequestsInFlight(defaultMaxRequestsInFlight)
+    , mMaxRetries(defaultMaxRetries)
+    , mDispatchScheduled(false)
+    , mRetryToken(0)
+{
+    mClock.start();
+}
+
 QGVLayerTilesOnline::~QGVLayerTilesOnline()
 {
-    qDeleteAll(mRequest);
+    QGVTileService::instance()->cancelAll(this);
+}
+
+void QGVLayerTilesOnline::setMaxRequestsInFlight(int value)
+{
+    mMaxRequestsInFlight = qMax(1, value);
+    qgvDebug() << "MaxRequestsInFlight changed to" << mMaxRequestsInFlight;
+    dispatch();
+}
+
+int QGVLayerTilesOnline::getMaxRequestsInFlight() const
+{
+    return mMaxRequestsInFlight;
+}
+
+int QGVLayerTilesOnline::countQueuedRequests() const
+{
+    return mQueue.size();
+}
+
+void QGVLayerTilesOnline::setMaxRetries(int value)
+{
+    mMaxRetries = qMax(0, value);
+    qgvDebug() << "MaxRetries changed to" << mMaxRetries;
+}
+
+int QGVLayerTilesOnline::getMaxRetries() const
+{
+    return mMaxRetries;
 }
 
 void QGVLayerTilesOnline::request(const QGV::GeoTilePos& tilePos)
 {
-    Q_ASSERT(QGV::getNetworkManager());
+    QGVTileStore* store = getTileStore();
+    if (store != nullptr) {
+        mStoreLoads.insert(tilePos);
+        store->load(getTileSetId(), tilePos, this, [this, tilePos](const QByteArray& rawImage) {
+            onStoreLoaded(tilePos, rawImage);
+        });
+        return;
+    }
+    requestNetwork(tilePos);
+}
+
+void QGVLayerTilesOnline::onStoreLoaded(const QGV::GeoTilePos& tilePos, const QByteArray& rawImage)
+{
+    if (!mStoreLoads.remove(tilePos)) {
+        return;
+    }
+    QGVTileStore* store = getTileStore();
+    if (!rawImage.isEmpty()) {
+        qgvDebug() << "load from store" << tilePos;
+        decode(tilePos, (store != nullptr) ? store->getFileName() : QString(), rawImage);
+        return;
+    }
+    if (store != nullptr && store->isOfflineOnly()) {
+        qgvDebug() << "offline, no stored tile" << tilePos;
+        onTileFailed(tilePos);
+        return;
+    }
+    requestNetwork(tilePos);
+}
+
+void QGVLayerTilesOnline::requestNetwork(const QGV::GeoTilePos& tilePos)
+{
+    auto failure = mFailures.find(tilePos);
+    if (failure != mFailures.end() && failure->blockedUntil > 0) {
+        if (mClock.elapsed() < failure->blockedUntil) {
+            qgvDebug() << "skip recently failed tile" << tilePos;
+            onTileFailed(tilePos);
+            return;
+        }
+        mFailures.erase(failure);
+    }
+    enqueue(tilePos);
+    dispatch();
+}
+
+void QGVLayerTilesOnline::cancel(const QGV::GeoTilePos& tilePos)
+{
+    mStoreLoads.remove(tilePos);
+    auto it = std::find_if(mQueue.begin(), mQueue.end(), [&tilePos](const QueuedTile& queued) {
+        return queued.tilePos == tilePos;
+    });
+    if (it != mQueue.end()) {
+        mQueue.erase(it);
+    }
+    if (mRequest.contains(tilePos)) {
+        removeReply(tilePos);
+        scheduleDispatch();
+    }
+    if (mRetry.remove(tilePos) > 0) {
+        mFailures.remove(tilePos);
+    }
+    removeDecode(tilePos);
+}
+
+void QGVLayerTilesOnline::reprioritize()
+{
+    for (QueuedTile& queued : mQueue) {
+        queued.priority = getTilePriority(queued.tilePos);
+    }
+    std::sort(mQueue.begin(), mQueue.end(), [](const QueuedTile& a, const QueuedTile& b) {
+        return a.priority > b.priority;
+    });
+    dispatch();
+}
+
+void QGVLayerTilesOnline::enqueue(const QGV::GeoTilePos& tilePos)
+{
+    const QueuedTile queued = { getTilePriority(tilePos), tilePos };
+    auto it = std::upper_bound(mQueue.begin(), mQueue.end(), queued, [](const QueuedTile& a, const QueuedTile& b) {
+        return a.priority > b.priority;
+    });
+    mQueue.insert(it, queued);
+}
+
+void QGVLayerTilesOnline::dispatch()
+{
+    mDispatchScheduled = false;
+    while (!mQueue.isEmpty() && mRequest.size() < mMaxRequestsInFlight) {
+        const QGV::GeoTilePos tilePos = mQueue.takeLast().tilePos;
+        send(tilePos);
+    }
+}
 
+void QGVLayerTilesOnline::scheduleDispatch()
+{
+    if (mDispatchScheduled) {
+        return;
+    }
+    mDispatchScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        if (mDispatchScheduled) {
+            dispatch();
+        }
+    });
+}
+
+void QGVLayerTilesOnline::send(const QGV::GeoTilePos& tilePos)
+{
     const QUrl url(tilePosToUrl(tilePos));
+    const QString key = url.toString();
+    if (!isHostAvailable(url.host(), key)) {
+        qgvDebug() << "host" << url.host() << "is unavailable, skip" << tilePos;
+        onTileFailed(tilePos);
+        return;
+    }
 
     QNetworkRequest request(url);
     QSslConfiguration conf = request.sslConfiguration();
@@ -42,50 +213,198 @@ void QGVLayerTilesOnline::request(const QGV::GeoTilePos& tilePos)
     request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
 
-    QNetworkReply* reply = QGV::getNetworkManager()->get(request);
-
-    mRequest[tilePos] = reply;
-    connect(reply, &QNetworkReply::finished, reply, [this, reply, tilePos]() { onReplyFinished(reply, tilePos); });
+    mRequest[tilePos] = key;
+    mKeys[key] = tilePos;
+    QGVTileService::instance()->fetch(this, key, request);
 
     qgvDebug() << "request" << url;
 }
 
-void QGVLayerTilesOnline::cancel(const QGV::GeoTilePos& tilePos)
+void QGVLayerTilesOnline::onTileReady(const QString& key,
+                                      const QByteArray& rawData,
+                                      const QImage& image,
+                                      qint64 networkMs,
+                                      qint64 decodeMs)
 {
-    removeReply(tilePos);
-}
+    auto it = mKeys.find(key);
+    if (it == mKeys.end()) {
+        return;
+    }
+    const QGV::GeoTilePos tilePos = it.value();
+    mKeys.erase(it);
+    metrics().addSample(QGVTileMetrics::Timing::DecodeTime, decodeMs);
+    if (mRequest.remove(tilePos) > 0) {
+        metrics().addCounter(QGVTileMetrics::Counter::BytesDownloaded, static_cast<quint64>(rawData.size()));
+        if (networkMs >= 0) {
+            metrics().addSample(QGVTileMetrics::Timing::NetworkLatency, networkMs);
+        }
+        onHostResult(QUrl(key).host(), true);
+        mFailures.remove(tilePos);
+        dispatch();
 
-void QGVLayerTilesOnline::onReplyFinished(QNetworkReply* reply, const QGV::GeoTilePos& tilePos)
-{
-    if (reply->error() != QNetworkReply::NoError) {
-        if (reply->error() != QNetworkReply::OperationCanceledError) {
-            qgvCritical() << "ERROR" << reply->errorString();
+        QGVTileStore* store = getTileStore();
+        if (store != nullptr) {
+            store->save(getTileSetId(), tilePos, rawData);
         }
-        removeReply(tilePos);
-        return;
+    } else {
+        mDecode.remove(tilePos);
     }
-    const auto rawImage = reply->readAll();
+
     auto tile = new QGVImage();
     tile->setGeometry(tilePos.toGeoRect());
-    tile->loadImage(rawImage);
+    tile->loadImage(image);
     tile->setProperty("drawDebug",
                       QString("%1\ntile(%2,%3,%4)")
-                              .arg(reply->url().toString())
+                              .arg(key)
                               .arg(tilePos.zoom())
                               .arg(tilePos.pos().x())
                               .arg(tilePos.pos().y()));
-    removeReply(tilePos);
     onTile(tilePos, tile);
 }
 
-void QGVLayerTilesOnline::removeReply(const QGV::GeoTilePos& tilePos)
+void QGVLayerTilesOnline::onTileFetchFailed(const QString& key,
+                                            QNetworkReply::NetworkError error,
+                                            const QString& errorString)
 {
-    QNetworkReply* reply = mRequest.value(tilePos, nullptr);
-    if (reply == nullptr) {
+    auto it = mKeys.find(key);
+    if (it == mKeys.end()) {
         return;
     }
+    const QGV::GeoTilePos tilePos = it.value();
+    mKeys.erase(it);
     mRequest.remove(tilePos);
-    reply->abort();
-    reply->close();
-    reply->deleteLater();
+    if (error == QNetworkReply::OperationCanceledError) {
+        cancelProbe(key);
+        return;
+    }
+    qgvCritical() << "ERROR" << errorString;
+    const bool permanent = isPermanentError(error);
+    onHostResult(QUrl(key).host(), permanent);
+    fail(tilePos, !permanent);
+    dispatch();
+}
+
+void QGVLayerTilesOnline::fail(const QGV::GeoTilePos& tilePos, bool retryable)
+{
+    TileFailure& failure = mFailures[tilePos];
+    failure.attempts++;
+    if (retryable && failure.attempts <= mMaxRetries) {
+        const int backoff = qMin(retryMaxDelayMs, retryBaseDelayMs << (failure.attempts - 1));
+        const int delay = backoff / 2 + static_cast<int>(QRandomGenerator::global()->bounded(backoff / 2 + 1));
+        const quint64 token = ++mRetryToken;
+        metrics().addCounter(QGVTileMetrics::Counter::Retried);
+        mRetry[tilePos] = token;
+        qgvDebug() << "retry" << tilePos << "attempt" << failure.attempts << "in" << delay << "ms";
+        QTimer::singleShot(delay, this, [this, tilePos, token]() { retry(tilePos, token); });
+        return;
+    }
+
+    failure.blockedUntil = mClock.elapsed() + negativeCacheMs;
+    if (mFailures.size() > negativeCacheLimit) {
+        const qint64 now = mClock.elapsed();
+        for (auto it = mFailures.begin(); it != mFailures.end();) {
+            if (it->blockedUntil > 0 && it->blockedUntil <= now) {
+                it = mFailures.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    onTileFailed(tilePos);
+}
+
+void QGVLayerTilesOnline::retry(const QGV::GeoTilePos& tilePos, quint64 token)
+{
+    auto it = mRetry.find(tilePos);
+    if (it == mRetry.end() || it.value() != token) {
+        return;
+    }
+    mRetry.erase(it);
+    enqueue(tilePos);
+    dispatch();
+}
+
+/*
+ * Expired circuit is half-open: only one probe request goes to host until it succeeds or fails.
+ */
+bool QGVLayerTilesOnline::isHostAvailable(const QString& host, const QString& key)
+{
+    auto it = mHosts.find(host);
+    if (it == mHosts.end() || (it->openUntil == 0 && it->probeKey.isEmpty())) {
+        return true;
+    }
+    if (!it->probeKey.isEmpty() || mClock.elapsed() < it->openUntil) {
+        return false;
+    }
+    qgvDebug() << "host" << host << "probe after circuit break";
+    it->openUntil = 0;
+    it->probeKey = key;
+    it->failures = circuitFailureThreshold - 1;
+    return true;
+}
+
+void QGVLayerTilesOnline::cancelProbe(const QString& key)
+{
+    auto it = mHosts.find(QUrl(key).host());
+    if (it == mHosts.end() || it->probeKey != key) {
+        return;
+    }
+    it->probeKey.clear();
+    it->openUntil = qMax<qint64>(1, mClock.elapsed());
+}
+
+void QGVLayerTilesOnline::onHostResult(const QString& host, bool reachable)
+{
+    HostCircuit& circuit = mHosts[host];
+    const bool probed = !circuit.probeKey.isEmpty();
+    circuit.probeKey.clear();
+    if (reachable) {
+        circuit.failures = 0;
+        circuit.openUntil = 0;
+        if (probed) {
+            qgvDebug() << "host" << host << "is available again";
+            QTimer::singleShot(0, this, [this]() { requestFailed(); });
+        }
+        return;
+    }
+    circuit.failures++;
+    if (circuit.failures >= circuitFailureThreshold && circuit.openUntil == 0) {
+        qgvCritical() << "host" << host << "failed" << circuit.failures << "times, pause requests for" << circuitOpenMs
+                      << "ms";
+        circuit.openUntil = mClock.elapsed() + circuitOpenMs;
+    }
+}
+
+void QGVLayerTilesOnline::decode(const QGV::GeoTilePos& tilePos, const QString& source, const QByteArray& rawImage)
+{
+    const QString key = QString("%1#%2/%3/%4/%5")
+                                .arg(source,
+                                     getTileSetId(),
+                                     QString::number(tilePos.zoom()),
+                                     QString::number(tilePos.pos().x()),
+                                     QString::number(tilePos.pos().y()));
+    mDecode[tilePos] = key;
+    mKeys[key] = tilePos;
+    QGVTileService::instance()->decode(this, key, rawImage);
+}
+
+void QGVLayerTilesOnline::removeReply(const QGV::GeoTilePos& tilePos)
+{
+    const QString key = mRequest.take(tilePos);
+    if (key.isEmpty()) {
+        return;
+    }
+    mKeys.remove(key);
+    cancelProbe(key);
+    QGVTileService::instance()->cancel(this, key);
+}
+
+void QGVLayerTilesOnline::removeDecode(const QGV::GeoTilePos& tilePos)
+{
+    const QString key = mDecode.take(tilePos);
+    if (key.isEmpty()) {
+        return;
+    }
+    mKeys.remove(key);
+    QGVTileService::instance()->cancel(this, key);
 }
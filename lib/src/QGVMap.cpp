@@ -49,6 +49,7 @@ RootItem::~RootItem() = default;
 
 QGVMap::QGVMap(QWidget* parent)
     : QWidget(parent)
+    , mUpdateLevel(0)
 {
     Q_INIT_RESOURCE(font);
     // Add all fonts in qrc:/fonts folder to font database
@@ -83,6 +84,11 @@ const QGVCameraState QGVMap::getCamera() const
     return geoView()->getCamera();
 }
 
+QGV::MapState QGVMap::getState() const
+{
+    return geoView()->getState();
+}
+
 void QGVMap::cameraTo(const QGVCameraActions& actions, bool animation)
 {
     geoView()->cameraTo(actions, animation);
@@ -301,6 +307,53 @@ QPoint QGVMap::mapFromProj(QPointF projPos)
     return mapPos;
 }
 
+void QGVMap::beginUpdate()
+{
+    mUpdateLevel++;
+}
+
+void QGVMap::endUpdate()
+{
+    Q_ASSERT(mUpdateLevel > 0);
+    if (--mUpdateLevel > 0) {
+        return;
+    }
+    /*
+     * Items which will be updated together with their parent are skipped, so every item is processed only once.
+     * Geometry of all items is flushed first, so recursive update of parent sees new geometry of its children.
+     */
+    const auto deferred = mDeferredItems;
+    mDeferredItems.clear();
+    for (const QPointer<QGVItem>& item : deferred) {
+        if (item.isNull() || !item->isDeferred(QGVItem::DeferUpdate)) {
+            continue;
+        }
+        for (QGVItem* parent = item->getParent(); parent != nullptr; parent = parent->getParent()) {
+            if (parent->isDeferred(QGVItem::DeferUpdate)) {
+                item->undefer(QGVItem::DeferUpdate);
+                break;
+            }
+        }
+    }
+    for (const QPointer<QGVItem>& item : deferred) {
+        if (!item.isNull()) {
+            item->flushDeferred(QGVItem::DeferBoundary);
+            item->undefer(QGVItem::DeferBoundary);
+        }
+    }
+    for (const QPointer<QGVItem>& item : deferred) {
+        if (!item.isNull()) {
+            item->flushDeferred(QGVItem::DeferUpdate | QGVItem::DeferRefresh);
+            item->undefer(QGVItem::DeferAll);
+        }
+    }
+}
+
+bool QGVMap::isUpdating() const
+{
+    return mUpdateLevel > 0;
+}
+
 void QGVMap::refreshMap()
 {
     qDebug()<<__FUNCTION__;
@@ -353,19 +406,33 @@ void QGVMap::onMapState(QGV::MapState state)
 
 void QGVMap::onMapCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
 {
+    QGV::CameraInterests changes;
     if (!qFuzzyCompare(oldState.azimuth(), newState.azimuth())) {
+        changes |= QGV::CameraInterest::Azimuth;
         Q_EMIT azimuthChanged();
     }
     if (!qFuzzyCompare(oldState.scale(), newState.scale())) {
+        changes |= QGV::CameraInterest::Scale;
         Q_EMIT scaleChanged();
     }
     if (oldState.projRect() != newState.projRect()) {
+        changes |= QGV::CameraInterest::Area;
         Q_EMIT areaChanged();
     }
 
-    auto root = static_cast<RootItem*>(rootItem());
-    if (root->isVisible()) {
-        root->onCamera(oldState, newState);
+    /*
+     * Only items subscribed to changed aspects of camera are notified. Items can leave during notification, so
+     * subscription is checked again before every call.
+     */
+    const auto items = mCameraItems;
+    for (QGVItem* item : items) {
+        if (!mCameraItems.contains(item)) {
+            continue;
+        }
+        const QGV::CameraInterests matched = item->getCameraInterests() & changes;
+        if (matched != QGV::CameraInterests() && item->effectivelyVisible()) {
+            item->onCamera(oldState, newState);
+        }
     }
     for (QGVWidget* widget : mWidgets) {
         if (widget->isVisible()) {
@@ -379,6 +446,17 @@ void QGVMap::onMapCamera(const QGVCameraState& oldState, const QGVCameraState& n
     }
 }
 
+void QGVMap::onMapCameraTarget(const QGVCameraActions& target)
+{
+    const auto items = mCameraItems;
+    for (QGVItem* item : items) {
+        if (mCameraItems.contains(item) && item->getCameraInterests().testFlag(QGV::CameraInterest::Target) &&
+            item->effectivelyVisible()) {
+            item->onCameraTarget(target);
+        }
+    }
+}
+
 void QGVMap::mouseMoveEvent(QMouseEvent* event)
 {
     if (hasMouseTracking()) {
@@ -426,3 +504,18 @@ void QGVMap::mouseDoubleClickEvent(QMouseEvent* event)
     event->ignore();
     QWidget::mouseDoubleClickEvent(event);
 }
+
+void QGVMap::deferItem(QGVItem* item)
+{
+    mDeferredItems.append(item);
+}
+
+void QGVMap::subscribeCamera(QGVItem* item)
+{
+    mCameraItems.insert(item);
+}
+
+void QGVMap::unsubscribeCamera(QGVItem* item)
+{
+    mCameraItems.remove(item);
+}
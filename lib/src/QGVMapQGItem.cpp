@@ -87,6 +87,11 @@ QPainterPath QGVMapQGItem::shape() const
     return mGeoObject->projShape();
 }
 
+bool QGVMapQGItem::contains(const QPointF& point) const
+{
+    return mGeoObject->projContains(point);
+}
+
 void QGVMapQGItem::hoverEnterEvent(QGraphicsSceneHoverEvent* /*event*/)
 {
     if (mGeoObject->isFlag(QGV::ItemFlag::Highlightable)) {
@@ -26,6 +26,7 @@
 
 #include <QApplication>
 #include <QParallelAnimationGroup>
+#include <QScreen>
 #include <QScrollBar>
 #include <QSequentialAnimationGroup>
 #include <QToolTip>
@@ -51,6 +52,9 @@ QGVMapQGView::QGVMapQGView(QGVMap* geoMap)
     mMouseActions = QGV::MouseAction::All;
     mViewRect = viewport()->rect();
     mState = QGV::MapState::Idle;
+    mCameraTimer.setSingleShot(true);
+    mCameraTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mCameraTimer, &QTimer::timeout, this, &QGVMapQGView::flushCameraUpdate);
     mQGScene.reset(new QGraphicsScene(this));
     mSelectionRect.reset(new QGVMapRubberBand(this));
     mSelectionRect->setMinSelection(QSize(5, 5));
@@ -82,7 +86,12 @@ QGV::MouseActions QGVMapQGView::getMouseActions() const
 QGVCameraState QGVMapQGView::getCamera() const
 {
     const bool animation = mState == QGV::MapState::Animation;
-    return QGVCameraState(mGeoMap, mAzimuth, mScale, viewRect(), animation);
+    return QGVCameraState(mGeoMap, mAzimuth, mScale, viewRect(), animation, mapToScene(mViewRect));
+}
+
+QGV::MapState QGVMapQGView::getState() const
+{
+    return mState;
 }
 
 void QGVMapQGView::cameraTo(const QGVCameraActions& actions, bool animation)
@@ -129,6 +138,7 @@ void QGVMapQGView::changeState(QGV::MapState state)
     if (mState == state) {
         return;
     }
+    flushCameraUpdate();
     if (mState == QGV::MapState::Animation) {
         QGVCameraState oldCamera = getCamera();
         mState = state;
@@ -205,6 +215,16 @@ void QGVMapQGView::applyCameraUpdate(const QGVCameraState& oldState)
     if (mBlockUpdateCount > 0) {
         return;
     }
+    if (mState == QGV::MapState::Wheel || mState == QGV::MapState::MovingMap) {
+        if (mPendingCamera.isNull()) {
+            mPendingCamera.reset(new QGVCameraState(oldState));
+            mCameraTimer.start(frameInterval());
+        }
+        return;
+    }
+    if (!mPendingCamera.isNull()) {
+        flushCameraUpdate();
+    }
     QGVCameraState newState = getCamera();
     if (oldState == newState) {
         return;
@@ -212,6 +232,36 @@ void QGVMapQGView::applyCameraUpdate(const QGVCameraState& oldState)
     mGeoMap->onMapCamera(oldState, newState);
 }
 
+/*
+ * Interactive camera changes are coalesced to one notification per frame, which carries state from the first
+ * change of this frame as old state.
+ */
+void QGVMapQGView::flushCameraUpdate()
+{
+    mCameraTimer.stop();
+    if (mPendingCamera.isNull()) {
+        return;
+    }
+    const QGVCameraState oldState = *mPendingCamera;
+    mPendingCamera.reset();
+    QGVCameraState newState = getCamera();
+    if (oldState == newState) {
+        return;
+    }
+    mGeoMap->onMapCamera(oldState, newState);
+}
+
+int QGVMapQGView::frameInterval() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QScreen* screen = this->screen();
+#else
+    const QScreen* screen = QGuiApplication::primaryScreen();
+#endif
+    const qreal refreshRate = (screen != nullptr) ? screen->refreshRate() : 0;
+    return (refreshRate > 1) ? qMax(1, qRound(1000.0 / refreshRate)) : 16;
+}
+
 void QGVMapQGView::showTooltip(QHelpEvent* helpEvent)
 {
     if (!mMouseActions.testFlag(QGV::MouseAction::Tooltip)) {
@@ -219,11 +269,10 @@ void QGVMapQGView::showTooltip(QHelpEvent* helpEvent)
     }
     helpEvent->accept();
     const QPointF projMouse = mapToScene(helpEvent->pos());
-    QGraphicsItem* item = itemAt(helpEvent->pos());
-    QGVDrawItem* geoObject = QGVMapQGItem::geoObjectFromQGItem(item);
+    const auto geoObjects = mGeoMap->search(projMouse, Qt::ContainsItemShape);
     QString toolTip = QString();
-    if (geoObject != nullptr) {
-        toolTip = geoObject->projTooltip(projMouse);
+    if (!geoObjects.isEmpty()) {
+        toolTip = geoObjects.first()->projTooltip(projMouse);
     }
     if (!toolTip.isEmpty()) {
         QToolTip::showText(helpEvent->globalPos(), toolTip);
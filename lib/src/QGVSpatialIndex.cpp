@@ -0,0 +1,368 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVSpatialIndex.h"
+
+#include <limits>
+#include <queue>
+
+namespace {
+const int maxEntries = 16;
+const int minEntries = 6;
+
+/*
+ * QRectF treats rectangles with zero width or height as empty, but points and lines are valid item bounds here.
+ */
+QRectF unite(const QRectF& rect1, const QRectF& rect2)
+{
+    const double left = qMin(rect1.left(), rect2.left());
+    const double top = qMin(rect1.top(), rect2.top());
+    const double right = qMax(rect1.right(), rect2.right());
+    const double bottom = qMax(rect1.bottom(), rect2.bottom());
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+bool intersects(const QRectF& rect1, const QRectF& rect2)
+{
+    return rect1.left() <= rect2.right() && rect2.left() <= rect1.right() && rect1.top() <= rect2.bottom() &&
+           rect2.top() <= rect1.bottom();
+}
+
+double area(const QRectF& rect)
+{
+    return rect.width() * rect.height();
+}
+
+double distance2(const QPointF& pos, const QRectF& rect)
+{
+    const double dx = qMax(qMax(rect.left() - pos.x(), 0.0), pos.x() - rect.right());
+    const double dy = qMax(qMax(rect.top() - pos.y(), 0.0), pos.y() - rect.bottom());
+    return dx * dx + dy * dy;
+}
+}
+
+QGVSpatialIndex::QGVSpatialIndex()
+    : mRoot(new Node())
+{
+}
+
+QGVSpatialIndex::~QGVSpatialIndex()
+{
+    deleteNode(mRoot);
+}
+
+void QGVSpatialIndex::clear()
+{
+    deleteNode(mRoot);
+    mRoot = new Node();
+    mLeafs.clear();
+}
+
+int QGVSpatialIndex::count() const
+{
+    return mLeafs.size();
+}
+
+bool QGVSpatialIndex::contains(QGVDrawItem* item) const
+{
+    return mLeafs.contains(item);
+}
+
+QRectF QGVSpatialIndex::rect(QGVDrawItem* item) const
+{
+    const Node* leaf = mLeafs.value(item, nullptr);
+    if (leaf == nullptr) {
+        return {};
+    }
+    for (const Entry& entry : leaf->entries) {
+        if (entry.item == item) {
+            return entry.rect;
+        }
+    }
+    return {};
+}
+
+void QGVSpatialIndex::insert(QGVDrawItem* item, const QRectF& projRect)
+{
+    remove(item);
+    insertEntry({ projRect.normalized(), nullptr, item });
+}
+
+void QGVSpatialIndex::remove(QGVDrawItem* item)
+{
+    Node* leaf = mLeafs.take(item);
+    if (leaf == nullptr) {
+        return;
+    }
+    for (int i = 0; i < leaf->entries.size(); ++i) {
+        if (leaf->entries.at(i).item == item) {
+            leaf->entries.remove(i);
+            break;
+        }
+    }
+    condenseTree(leaf);
+}
+
+void QGVSpatialIndex::search(const QRectF& projRect, QList<QGVDrawItem*>& result) const
+{
+    const QRectF area = projRect.normalized();
+    QVector<const Node*> stack;
+    stack.append(mRoot);
+    while (!stack.isEmpty()) {
+        const Node* node = stack.takeLast();
+        for (const Entry& entry : node->entries) {
+            if (!intersects(entry.rect, area)) {
+                continue;
+            }
+            if (node->leaf) {
+                result.append(entry.item);
+            } else {
+                stack.append(entry.child);
+            }
+        }
+    }
+}
+
+void QGVSpatialIndex::nearest(const QPointF& projPos, int count, QList<QGVDrawItem*>& result) const
+{
+    /*
+     * Best-first traversal: nodes and items are visited by distance from position to their rectangle, so first
+     * items taken from queue are nearest ones.
+     */
+    typedef QPair<double, const Entry*> Candidate;
+    auto greater = [](const Candidate& left, const Candidate& right) { return left.first > right.first; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(greater)> queue(greater);
+    const Entry rootEntry = { QRectF(), mRoot, nullptr };
+    queue.push(Candidate(0, &rootEntry));
+    while (!queue.empty() && count > 0) {
+        const Entry* entry = queue.top().second;
+        queue.pop();
+        if (entry->child == nullptr) {
+            result.append(entry->item);
+            count--;
+            continue;
+        }
+        for (const Entry& childEntry : entry->child->entries) {
+            queue.push(Candidate(distance2(projPos, childEntry.rect), &childEntry));
+        }
+    }
+}
+
+QGVSpatialIndex::Node* QGVSpatialIndex::chooseLeaf(const QRectF& projRect) const
+{
+    Node* node = mRoot;
+    while (!node->leaf) {
+        const Entry* best = nullptr;
+        double bestGrowth = std::numeric_limits<double>::max();
+        double bestArea = std::numeric_limits<double>::max();
+        for (const Entry& entry : node->entries) {
+            const double entryArea = area(entry.rect);
+            const double growth = area(unite(entry.rect, projRect)) - entryArea;
+            if (growth < bestGrowth || (growth == bestGrowth && entryArea < bestArea)) {
+                best = &entry;
+                bestGrowth = growth;
+                bestArea = entryArea;
+            }
+        }
+        node = best->child;
+    }
+    return node;
+}
+
+void QGVSpatialIndex::insertEntry(const Entry& entry)
+{
+    Node* leaf = chooseLeaf(entry.rect);
+    leaf->entries.append(entry);
+    mLeafs.insert(entry.item, leaf);
+    adjustTree(leaf);
+}
+
+void QGVSpatialIndex::adjustTree(Node* node)
+{
+    while (node != nullptr) {
+        Node* sibling = (node->entries.size() > maxEntries) ? split(node) : nullptr;
+        Node* parent = node->parent;
+        if (parent == nullptr) {
+            if (sibling != nullptr) {
+                mRoot = new Node();
+                mRoot->leaf = false;
+                setEntryParent(mRoot, { QRectF(), node, nullptr });
+                setEntryParent(mRoot, { QRectF(), sibling, nullptr });
+            }
+            return;
+        }
+        refreshEntry(parent, node);
+        if (sibling != nullptr) {
+            setEntryParent(parent, { QRectF(), sibling, nullptr });
+        }
+        node = parent;
+    }
+}
+
+QGVSpatialIndex::Node* QGVSpatialIndex::split(Node* node)
+{
+    /*
+     * Quadratic split: two entries which waste most area together become seeds of groups, rest of entries go to
+     * group which grows least.
+     */
+    const QVector<Entry> entries = node->entries;
+    int seed1 = 0;
+    int seed2 = 1;
+    double worstWaste = -std::numeric_limits<double>::max();
+    for (int i = 0; i < entries.size(); ++i) {
+        for (int j = i + 1; j < entries.size(); ++j) {
+            const double waste = area(unite(entries.at(i).rect, entries.at(j).rect)) - area(entries.at(i).rect) -
+                                 area(entries.at(j).rect);
+            if (waste > worstWaste) {
+                worstWaste = waste;
+                seed1 = i;
+                seed2 = j;
+            }
+        }
+    }
+
+    Node* sibling = new Node();
+    sibling->leaf = node->leaf;
+    node->entries.clear();
+    setEntryParent(node, entries.at(seed1));
+    setEntryParent(sibling, entries.at(seed2));
+    QRectF rect1 = entries.at(seed1).rect;
+    QRectF rect2 = entries.at(seed2).rect;
+    int remaining = entries.size() - 2;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (i == seed1 || i == seed2) {
+            continue;
+        }
+        const Entry& entry = entries.at(i);
+        bool toFirst;
+        if (node->entries.size() + remaining <= minEntries) {
+            toFirst = true;
+        } else if (sibling->entries.size() + remaining <= minEntries) {
+            toFirst = false;
+        } else {
+            const double growth1 = area(unite(rect1, entry.rect)) - area(rect1);
+            const double growth2 = area(unite(rect2, entry.rect)) - area(rect2);
+            if (growth1 != growth2) {
+                toFirst = growth1 < growth2;
+            } else if (area(rect1) != area(rect2)) {
+                toFirst = area(rect1) < area(rect2);
+            } else {
+                toFirst = node->entries.size() <= sibling->entries.size();
+            }
+        }
+        if (toFirst) {
+            setEntryParent(node, entry);
+            rect1 = unite(rect1, entry.rect);
+        } else {
+            setEntryParent(sibling, entry);
+            rect2 = unite(rect2, entry.rect);
+        }
+        remaining--;
+    }
+    return sibling;
+}
+
+void QGVSpatialIndex::condenseTree(Node* node)
+{
+    QVector<Entry> orphans;
+    while (node != mRoot) {
+        Node* parent = node->parent;
+        if (node->entries.size() < minEntries) {
+            for (int i = 0; i < parent->entries.size(); ++i) {
+                if (parent->entries.at(i).child == node) {
+                    parent->entries.remove(i);
+                    break;
+                }
+            }
+            collectEntries(node, orphans);
+        } else {
+            refreshEntry(parent, node);
+        }
+        node = parent;
+    }
+    while (!mRoot->leaf && mRoot->entries.size() == 1) {
+        Node* root = mRoot;
+        mRoot = root->entries.first().child;
+        mRoot->parent = nullptr;
+        root->entries.clear();
+        delete root;
+    }
+    if (!mRoot->leaf && mRoot->entries.isEmpty()) {
+        mRoot->leaf = true;
+    }
+    for (const Entry& entry : orphans) {
+        insertEntry(entry);
+    }
+}
+
+void QGVSpatialIndex::collectEntries(Node* node, QVector<Entry>& result)
+{
+    for (const Entry& entry : node->entries) {
+        if (node->leaf) {
+            result.append(entry);
+        } else {
+            collectEntries(entry.child, result);
+        }
+    }
+    node->entries.clear();
+    delete node;
+}
+
+void QGVSpatialIndex::deleteNode(Node* node)
+{
+    if (!node->leaf) {
+        for (const Entry& entry : node->entries) {
+            deleteNode(entry.child);
+        }
+    }
+    delete node;
+}
+
+void QGVSpatialIndex::setEntryParent(Node* node, const Entry& entry)
+{
+    Entry added = entry;
+    if (added.child != nullptr) {
+        added.child->parent = node;
+        added.rect = bounds(added.child);
+    } else {
+        mLeafs.insert(added.item, node);
+    }
+    node->entries.append(added);
+}
+
+void QGVSpatialIndex::refreshEntry(Node* parent, const Node* child)
+{
+    for (Entry& entry : parent->entries) {
+        if (entry.child == child) {
+            entry.rect = bounds(child);
+            return;
+        }
+    }
+}
+
+QRectF QGVSpatialIndex::bounds(const Node* node)
+{
+    if (node->entries.isEmpty()) {
+        return {};
+    }
+    QRectF result = node->entries.first().rect;
+    for (const Entry& entry : node->entries) {
+        result = unite(result, entry.rect);
+    }
+    return result;
+}
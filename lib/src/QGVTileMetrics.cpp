@@ -0,0 +1,131 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileMetrics.h"
+
+namespace {
+const int counterCount = static_cast<int>(QGVTileMetrics::Counter::BytesDownloaded) + 1;
+const int timingCount = static_cast<int>(QGVTileMetrics::Timing::ViewportComplete) + 1;
+const int bucketCount = 24;
+
+int bucketIndex(qint64 value)
+{
+    int index = 0;
+    while (value > 0 && index < bucketCount - 1) {
+        value >>= 1;
+        index++;
+    }
+    return index;
+}
+}
+
+QGVTileMetrics::Histogram::Histogram()
+    : mBuckets(bucketCount, 0)
+{
+    clear();
+}
+
+void QGVTileMetrics::Histogram::addSample(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    mMin = (mCount == 0) ? value : qMin(mMin, value);
+    mMax = (mCount == 0) ? value : qMax(mMax, value);
+    mCount++;
+    mTotal += value;
+    mBuckets[bucketIndex(value)]++;
+}
+
+void QGVTileMetrics::Histogram::clear()
+{
+    mCount = 0;
+    mTotal = 0;
+    mMin = 0;
+    mMax = 0;
+    mBuckets.fill(0);
+}
+
+quint64 QGVTileMetrics::Histogram::getCount() const
+{
+    return mCount;
+}
+
+qint64 QGVTileMetrics::Histogram::getMin() const
+{
+    return mMin;
+}
+
+qint64 QGVTileMetrics::Histogram::getMax() const
+{
+    return mMax;
+}
+
+double QGVTileMetrics::Histogram::getMean() const
+{
+    return (mCount > 0) ? static_cast<double>(mTotal) / mCount : 0.0;
+}
+
+qint64 QGVTileMetrics::Histogram::getPercentile(double percent) const
+{
+    if (mCount == 0) {
+        return 0;
+    }
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(qBound(0.0, percent, 100.0) / 100.0 * mCount + 0.5));
+    quint64 total = 0;
+    for (int i = 0; i < mBuckets.size(); ++i) {
+        total += mBuckets.at(i);
+        if (total >= rank) {
+            const qint64 upper = (i == 0) ? 0 : (Q_INT64_C(1) << i) - 1;
+            return qBound(mMin, upper, mMax);
+        }
+    }
+    return mMax;
+}
+
+QGVTileMetrics::QGVTileMetrics()
+    : mCounters(counterCount, 0)
+    , mHistograms(timingCount)
+{
+}
+
+void QGVTileMetrics::clear()
+{
+    mCounters.fill(0);
+    for (Histogram& histogram : mHistograms) {
+        histogram.clear();
+    }
+}
+
+void QGVTileMetrics::addCounter(Counter counter, quint64 value)
+{
+    mCounters[static_cast<int>(counter)] += value;
+}
+
+quint64 QGVTileMetrics::getCounter(Counter counter) const
+{
+    return mCounters.at(static_cast<int>(counter));
+}
+
+void QGVTileMetrics::addSample(Timing timing, qint64 value)
+{
+    mHistograms[static_cast<int>(timing)].addSample(value);
+}
+
+const QGVTileMetrics::Histogram& QGVTileMetrics::getHistogram(Timing timing) const
+{
+    return mHistograms.at(static_cast<int>(timing));
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileMosaic.h"
+
+#include <QPainter>
+
+QGVTileMosaic::QGVTileMosaic(int zoom)
+    : mZoom(zoom)
+{
+    setFlag(QGV::ItemFlag::NoCache);
+    setSelectable(false);
+}
+
+int QGVTileMosaic::getZoom() const
+{
+    return mZoom;
+}
+
+int QGVTileMosaic::countTiles() const
+{
+    return mCells.size();
+}
+
+bool QGVTileMosaic::isEmpty() const
+{
+    return mCells.isEmpty();
+}
+
+bool QGVTileMosaic::containsTile(const QGV::GeoTilePos& tilePos) const
+{
+    return mCells.contains(tilePos);
+}
+
+QImage QGVTileMosaic::getTile(const QGV::GeoTilePos& tilePos) const
+{
+    return mCells.value(tilePos).image;
+}
+
+void QGVTileMosaic::setTile(const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    Cell& cell = mCells[tilePos];
+    cell.projRect = cellProjRect(tilePos);
+    cell.image = image;
+    repaint(cell.projRect);
+}
+
+void QGVTileMosaic::removeTile(const QGV::GeoTilePos& tilePos)
+{
+    auto it = mCells.find(tilePos);
+    if (it == mCells.end()) {
+        return;
+    }
+    const QRectF projRect = it->projRect;
+    mCells.erase(it);
+    repaint(projRect);
+}
+
+void QGVTileMosaic::onProjection(QGVMap* geoMap)
+{
+    QGVDrawItem::onProjection(geoMap);
+    calculateGeometry();
+}
+
+QPainterPath QGVTileMosaic::projShape() const
+{
+    QPainterPath path;
+    path.addRect(mProjRect);
+    return path;
+}
+
+void QGVTileMosaic::projPaint(QPainter* painter)
+{
+    QRectF visibleRect = getMap()->getCamera().projRect();
+    if (painter->hasClipping()) {
+        visibleRect = visibleRect.intersected(painter->clipBoundingRect());
+    }
+    const double pixelFactor = 1.0 / getMap()->getCamera().scale();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    for (const Cell& cell : mCells) {
+        if (cell.image.isNull() || !cell.projRect.intersects(visibleRect)) {
+            continue;
+        }
+        QRectF paintRect = cell.projRect;
+        paintRect.setSize(paintRect.size() + QSizeF(pixelFactor, pixelFactor));
+        painter->drawImage(paintRect, cell.image);
+    }
+}
+
+void QGVTileMosaic::calculateGeometry()
+{
+    if (getMap() == nullptr) {
+        return;
+    }
+    mProjRect = getMap()->getProjection()->boundaryProjRect();
+    for (auto it = mCells.begin(); it != mCells.end(); ++it) {
+        it->projRect = cellProjRect(it.key());
+    }
+    resetBoundary();
+    refresh();
+}
+
+QRectF QGVTileMosaic::cellProjRect(const QGV::GeoTilePos& tilePos) const
+{
+    if (getMap() == nullptr) {
+        return {};
+    }
+    return getMap()->getProjection()->geoToProj(tilePos.toGeoRect());
+}
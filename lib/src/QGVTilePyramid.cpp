@@ -0,0 +1,228 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTilePyramid.h"
+
+namespace {
+int childIndex(const QGV::GeoTilePos& tilePos)
+{
+    return ((tilePos.pos().y() & 1) << 1) | (tilePos.pos().x() & 1);
+}
+
+QGV::GeoTilePos parentPos(const QGV::GeoTilePos& tilePos)
+{
+    return QGV::GeoTilePos(tilePos.zoom() - 1, QPoint(tilePos.pos().x() >> 1, tilePos.pos().y() >> 1));
+}
+}
+
+QGVTilePyramid::QGVTilePyramid()
+{
+}
+
+QGVTilePyramid::~QGVTilePyramid()
+{
+    clear();
+}
+
+void QGVTilePyramid::clear()
+{
+    for (const auto& level : mLevels) {
+        qDeleteAll(level);
+    }
+    mLevels.clear();
+}
+
+bool QGVTilePyramid::contains(const QGV::GeoTilePos& tilePos) const
+{
+    const Node* node = findNode(tilePos);
+    return node != nullptr && node->present;
+}
+
+QGVDrawItem* QGVTilePyramid::item(const QGV::GeoTilePos& tilePos) const
+{
+    const Node* node = findNode(tilePos);
+    return (node != nullptr && node->present) ? node->item : nullptr;
+}
+
+QGVTilePyramid::TileState QGVTilePyramid::state(const QGV::GeoTilePos& tilePos) const
+{
+    const Node* node = findNode(tilePos);
+    if (node == nullptr || !node->present) {
+        return TileState::Missing;
+    }
+    if (node->item != nullptr) {
+        return TileState::Loaded;
+    }
+    return (node->failed) ? TileState::Failed : TileState::Pending;
+}
+
+const QGVTilePyramid::Node* QGVTilePyramid::node(const QGV::GeoTilePos& tilePos) const
+{
+    return findNode(tilePos);
+}
+
+int QGVTilePyramid::count(int zoom) const
+{
+    if (zoom < 0 || zoom >= mLevels.size()) {
+        return 0;
+    }
+    int count = 0;
+    for (const Node* node : mLevels.at(zoom)) {
+        if (node->present) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void QGVTilePyramid::insert(const QGV::GeoTilePos& tilePos, QGVDrawItem* item)
+{
+    Node* node = ensureNode(tilePos);
+    node->item = item;
+    node->failed = false;
+    if (!node->present) {
+        node->present = true;
+        adjustPresentBelow(node->parent, 1);
+    }
+}
+
+QGVDrawItem* QGVTilePyramid::take(const QGV::GeoTilePos& tilePos)
+{
+    Node* node = findNode(tilePos);
+    if (node == nullptr || !node->present) {
+        return nullptr;
+    }
+    QGVDrawItem* item = node->item;
+    node->item = nullptr;
+    node->present = false;
+    node->failed = false;
+    adjustPresentBelow(node->parent, -1);
+    prune(node);
+    return item;
+}
+
+void QGVTilePyramid::setFailed(const QGV::GeoTilePos& tilePos)
+{
+    Node* node = findNode(tilePos);
+    if (node == nullptr || !node->present || node->item != nullptr) {
+        return;
+    }
+    node->failed = true;
+}
+
+void QGVTilePyramid::collect(QVector<QGV::GeoTilePos>& result) const
+{
+    result.clear();
+    for (const auto& level : mLevels) {
+        for (const Node* node : level) {
+            if (node->present) {
+                result.append(node->pos);
+            }
+        }
+    }
+}
+
+void QGVTilePyramid::collect(int zoom, QVector<QGV::GeoTilePos>& result) const
+{
+    result.clear();
+    if (zoom < 0 || zoom >= mLevels.size()) {
+        return;
+    }
+    for (const Node* node : mLevels.at(zoom)) {
+        if (node->present) {
+            result.append(node->pos);
+        }
+    }
+}
+
+void QGVTilePyramid::collectFailed(int zoom, QVector<QGV::GeoTilePos>& result) const
+{
+    result.clear();
+    if (zoom < 0 || zoom >= mLevels.size()) {
+        return;
+    }
+    for (const Node* node : mLevels.at(zoom)) {
+        if (node->present && node->failed) {
+            result.append(node->pos);
+        }
+    }
+}
+
+QGVTilePyramid::Node* QGVTilePyramid::findNode(const QGV::GeoTilePos& tilePos) const
+{
+    const int zoom = tilePos.zoom();
+    if (zoom < 0 || zoom >= mLevels.size()) {
+        return nullptr;
+    }
+    return mLevels.at(zoom).value(tilePos, nullptr);
+}
+
+QGVTilePyramid::Node* QGVTilePyramid::ensureNode(const QGV::GeoTilePos& tilePos)
+{
+    Node* node = findNode(tilePos);
+    if (node != nullptr) {
+        return node;
+    }
+    const int zoom = tilePos.zoom();
+    if (zoom >= mLevels.size()) {
+        mLevels.resize(zoom + 1);
+    }
+    node = new Node();
+    node->pos = tilePos;
+    if (zoom > 0) {
+        node->parent = ensureNode(parentPos(tilePos));
+        node->parent->children[childIndex(tilePos)] = node;
+    }
+    mLevels[zoom].insert(tilePos, node);
+    return node;
+}
+
+void QGVTilePyramid::adjustPresentBelow(Node* node, int delta)
+{
+    for (; node != nullptr; node = node->parent) {
+        node->presentBelow += delta;
+    }
+}
+
+void QGVTilePyramid::prune(Node* node)
+{
+    while (node != nullptr && !node->present && node->presentBelow == 0) {
+        Node* parent = node->parent;
+        if (parent != nullptr) {
+            parent->children[childIndex(node->pos)] = nullptr;
+        }
+        unlink(node);
+        delete node;
+        node = parent;
+    }
+}
+
+void QGVTilePyramid::unlink(Node* node)
+{
+    mLevels[node->pos.zoom()].remove(node->pos);
+}
+
+void QGVTilePyramid::unlinkSubtree(Node* node)
+{
+    for (Node* child : node->children) {
+        if (child != nullptr) {
+            unlinkSubtree(child);
+        }
+    }
+    unlink(node);
+}
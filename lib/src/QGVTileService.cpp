@@ -0,0 +1,240 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileService.h"
+
+#include <QElapsedTimer>
+#include <QRunnable>
+
+#include <atomic>
+#include <functional>
+
+/*
+ * Decodes raw tile data in the worker pool. Task object lives in GUI thread, so result is delivered back
+ * by queued call and callback is never executed after cancel().
+ */
+class QGVTileService::DecodeTask : public QObject, public QRunnable
+{
+public:
+    DecodeTask(const QByteArray& rawData, std::function<void(const QImage&, qint64)> onDecoded)
+        : mRawData(rawData)
+        , mOnDecoded(onDecoded)
+        , mCancelled(false)
+    {
+        setAutoDelete(false);
+    }
+
+    void cancel()
+    {
+        mCancelled = true;
+        mOnDecoded = nullptr;
+    }
+
+private:
+    void run() override
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QImage image;
+        if (!mCancelled) {
+            image.loadFromData(mRawData);
+            if (!image.isNull()) {
+                image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            }
+        }
+        const qint64 decodeMs = timer.elapsed();
+        QMetaObject::invokeMethod(
+                this, [this, image, decodeMs]() { finish(image, decodeMs); }, Qt::QueuedConnection);
+    }
+
+    void finish(const QImage& image, qint64 decodeMs)
+    {
+        if (mOnDecoded) {
+            mOnDecoded(image, decodeMs);
+        }
+        deleteLater();
+    }
+
+private:
+    QByteArray mRawData;
+    std::function<void(const QImage&, qint64)> mOnDecoded;
+    std::atomic<bool> mCancelled;
+};
+
+QGVTileService* QGVTileService::instance()
+{
+    static QGVTileService service;
+    return &service;
+}
+
+QGVTileService::QGVTileService()
+{
+}
+
+QGVTileService::~QGVTileService()
+{
+    for (Entry& entry : mEntries) {
+        abort(entry);
+    }
+}
+
+void QGVTileService::fetch(Subscriber* subscriber, const QString& key, const QNetworkRequest& request)
+{
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        it->subscribers.insert(subscriber);
+        qgvDebug() << "join request" << key << "with" << it->subscribers.size() << "subscribers";
+        return;
+    }
+    Q_ASSERT(QGV::getNetworkManager());
+
+    Entry& entry = mEntries[key];
+    entry.subscribers.insert(subscriber);
+    entry.timer.start();
+    QNetworkReply* reply = QGV::getNetworkManager()->get(request);
+    entry.reply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, key, reply]() { onReplyFinished(key, reply); });
+}
+
+void QGVTileService::decode(Subscriber* subscriber, const QString& key, const QByteArray& rawData)
+{
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        it->subscribers.insert(subscriber);
+        return;
+    }
+    mEntries[key].subscribers.insert(subscriber);
+    startDecode(key, rawData);
+}
+
+void QGVTileService::cancel(Subscriber* subscriber, const QString& key)
+{
+    auto it = mEntries.find(key);
+    if (it == mEntries.end()) {
+        return;
+    }
+    it->subscribers.remove(subscriber);
+    if (!it->subscribers.isEmpty()) {
+        return;
+    }
+    Entry entry = *it;
+    mEntries.erase(it);
+    abort(entry);
+}
+
+void QGVTileService::cancelAll(Subscriber* subscriber)
+{
+    for (QSet<Subscriber*>* notified : mNotified) {
+        notified->remove(subscriber);
+    }
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        it->subscribers.remove(subscriber);
+        if (!it->subscribers.isEmpty()) {
+            ++it;
+            continue;
+        }
+        Entry entry = *it;
+        it = mEntries.erase(it);
+        abort(entry);
+    }
+}
+
+int QGVTileService::countRequests() const
+{
+    return mEntries.size();
+}
+
+int QGVTileService::countSubscribers(const QString& key) const
+{
+    return mEntries.value(key).subscribers.size();
+}
+
+void QGVTileService::startDecode(const QString& key, const QByteArray& rawData)
+{
+    auto task = new DecodeTask(rawData, [this, key, rawData](const QImage& image, qint64 decodeMs) {
+        onDecoded(key, rawData, image, decodeMs);
+    });
+    mEntries[key].task = task;
+    mDecodePool.start(task);
+}
+
+void QGVTileService::onReplyFinished(const QString& key, QNetworkReply* reply)
+{
+    auto it = mEntries.find(key);
+    if (it == mEntries.end() || it->reply != reply) {
+        return;
+    }
+    it->reply = nullptr;
+    it->networkMs = it->timer.elapsed();
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        const QSet<Subscriber*> subscribers = it->subscribers;
+        mEntries.erase(it);
+        const QNetworkReply::NetworkError error = reply->error();
+        const QString errorString = reply->errorString();
+        notify(subscribers, [&key, error, &errorString](Subscriber* subscriber) {
+            subscriber->onTileFetchFailed(key, error, errorString);
+        });
+        return;
+    }
+    startDecode(key, reply->readAll());
+}
+
+void QGVTileService::onDecoded(const QString& key, const QByteArray& rawData, const QImage& image, qint64 decodeMs)
+{
+    const Entry entry = mEntries.take(key);
+    notify(entry.subscribers, [&](Subscriber* subscriber) {
+        subscriber->onTileReady(key, rawData, image, entry.networkMs, decodeMs);
+    });
+}
+
+void QGVTileService::abort(Entry& entry)
+{
+    if (!entry.reply.isNull()) {
+        QNetworkReply* reply = entry.reply.data();
+        entry.reply = nullptr;
+        reply->abort();
+        reply->close();
+        reply->deleteLater();
+    }
+    if (entry.task != nullptr) {
+        DecodeTask* task = entry.task;
+        entry.task = nullptr;
+        if (mDecodePool.tryTake(task)) {
+            delete task;
+        } else {
+            task->cancel();
+        }
+    }
+}
+
+/*
+ * Subscriber cancelled or destroyed by another subscriber during notification is skipped.
+ */
+void QGVTileService::notify(QSet<Subscriber*> subscribers, std::function<void(Subscriber*)> call)
+{
+    mNotified.append(&subscribers);
+    while (!subscribers.isEmpty()) {
+        const auto it = subscribers.begin();
+        Subscriber* subscriber = *it;
+        subscribers.erase(it);
+        call(subscriber);
+    }
+    mNotified.removeOne(&subscribers);
+}
@@ -0,0 +1,428 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileStore.h"
+
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+
+namespace {
+const quint32 fileMagic = 0x51475653; // QGVS
+const quint32 fileVersion = 1;
+const quint32 recordMagic = 0x54494C45; // TILE
+const qint64 fileHeaderSize = 2 * sizeof(quint32);
+const qint64 defaultMaxSize = 512 * 1024 * 1024;
+const double compactRatio = 0.75;
+const int streamVersion = QDataStream::Qt_5_6;
+
+qint64 recordHeaderSize(const QString& layerId)
+{
+    /*
+     * Magic, layer id (byte length and UTF-16 data), zoom, x, y and data size.
+     */
+    return 2 * sizeof(quint32) + 2 * layerId.size() + 4 * sizeof(qint32);
+}
+}
+
+class QGVTileStore::Job : public QRunnable
+{
+public:
+    explicit Job(std::function<void()> run)
+        : mRun(run)
+    {
+    }
+
+private:
+    void run() override
+    {
+        mRun();
+    }
+
+private:
+    std::function<void()> mRun;
+};
+
+QGVTileStore::QGVTileStore(const QString& fileName, QObject* parent)
+    : QObject(parent)
+    , mFileName(fileName)
+    , mFile(fileName)
+    , mMaxSize(defaultMaxSize)
+    , mOfflineOnly(false)
+    , mAccessCounter(0)
+{
+    mPool.setMaxThreadCount(1);
+    post([this, fileName]() {
+        QMutexLocker locker(&mMutex);
+        if (!open()) {
+            qgvCritical() << "tile store" << fileName << "can't be opened:" << mFile.errorString();
+        }
+    });
+}
+
+QGVTileStore::~QGVTileStore()
+{
+    mPool.waitForDone();
+    mFile.close();
+}
+
+bool QGVTileStore::isOpen() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFile.isOpen();
+}
+
+QString QGVTileStore::getFileName() const
+{
+    return mFileName;
+}
+
+void QGVTileStore::setMaxSize(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mMaxSize = bytes;
+    }
+    qgvDebug() << "tile store max size changed to" << bytes;
+    post([this]() {
+        QMutexLocker locker(&mMutex);
+        if (mFile.isOpen() && mFile.size() > mMaxSize) {
+            compact(static_cast<qint64>(mMaxSize * compactRatio));
+        }
+    });
+}
+
+qint64 QGVTileStore::getMaxSize() const
+{
+    QMutexLocker locker(&mMutex);
+    return mMaxSize;
+}
+
+qint64 QGVTileStore::getSize() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFile.isOpen() ? mFile.size() : 0;
+}
+
+int QGVTileStore::countTiles() const
+{
+    QMutexLocker locker(&mMutex);
+    return countEntries();
+}
+
+void QGVTileStore::setOfflineOnly(bool enabled)
+{
+    mOfflineOnly = enabled;
+    qgvDebug() << "tile store offline only changed to" << enabled;
+}
+
+bool QGVTileStore::isOfflineOnly() const
+{
+    return mOfflineOnly;
+}
+
+bool QGVTileStore::contains(const QString& layerId, const QGV::GeoTilePos& tilePos) const
+{
+    QMutexLocker locker(&mMutex);
+    return mIndex.value(layerId).contains(tilePos);
+}
+
+QByteArray QGVTileStore::load(const QString& layerId, const QGV::GeoTilePos& tilePos)
+{
+    QMutexLocker locker(&mMutex);
+    return read(layerId, tilePos);
+}
+
+/*
+ * Tile is read by worker thread. Callback is called in GUI thread, with empty data for missing tile, and is dropped
+ * when receiver is deleted before.
+ */
+void QGVTileStore::load(const QString& layerId,
+                        const QGV::GeoTilePos& tilePos,
+                        QObject* receiver,
+                        std::function<void(const QByteArray&)> onLoaded)
+{
+    QPointer<QObject> guard(receiver);
+    post([this, layerId, tilePos, guard, onLoaded]() {
+        QByteArray rawData;
+        {
+            QMutexLocker locker(&mMutex);
+            rawData = read(layerId, tilePos);
+        }
+        QMetaObject::invokeMethod(
+                this,
+                [guard, onLoaded, rawData]() {
+                    if (!guard.isNull()) {
+                        onLoaded(rawData);
+                    }
+                },
+                Qt::QueuedConnection);
+    });
+}
+
+/*
+ * Tile is written by worker thread. Tile which is already stored is not written again.
+ */
+void QGVTileStore::save(const QString& layerId, const QGV::GeoTilePos& tilePos, const QByteArray& rawData)
+{
+    if (rawData.isEmpty()) {
+        return;
+    }
+    post([this, layerId, tilePos, rawData]() {
+        QMutexLocker locker(&mMutex);
+        if (!mFile.isOpen() || mIndex.value(layerId).contains(tilePos)) {
+            return;
+        }
+        Entry entry;
+        if (!mFile.seek(mFile.size()) || !writeRecord(mFile, layerId, tilePos, rawData, entry)) {
+            qgvCritical() << "tile store" << getFileName() << "write error:" << mFile.errorString();
+            return;
+        }
+        mFile.flush();
+        entry.access = ++mAccessCounter;
+        mIndex[layerId][tilePos] = entry;
+
+        if (mFile.size() > mMaxSize) {
+            compact(static_cast<qint64>(mMaxSize * compactRatio));
+        }
+    });
+}
+
+void QGVTileStore::compact()
+{
+    post([this]() {
+        QMutexLocker locker(&mMutex);
+        compact(mMaxSize);
+    });
+}
+
+void QGVTileStore::clear()
+{
+    post([this]() {
+        QMutexLocker locker(&mMutex);
+        if (!mFile.isOpen()) {
+            return;
+        }
+        mIndex.clear();
+        mFile.resize(fileHeaderSize);
+        qgvDebug() << "tile store" << getFileName() << "cleared";
+    });
+}
+
+void QGVTileStore::waitForDone()
+{
+    mPool.waitForDone();
+}
+
+void QGVTileStore::post(std::function<void()> job)
+{
+    mPool.start(new Job(job));
+}
+
+int QGVTileStore::countEntries() const
+{
+    int count = 0;
+    for (const LayerIndex& layerIndex : mIndex) {
+        count += layerIndex.count();
+    }
+    return count;
+}
+
+QByteArray QGVTileStore::read(const QString& layerId, const QGV::GeoTilePos& tilePos)
+{
+    if (!mFile.isOpen()) {
+        return {};
+    }
+    auto layerIt = mIndex.find(layerId);
+    if (layerIt == mIndex.end()) {
+        return {};
+    }
+    auto entryIt = layerIt->find(tilePos);
+    if (entryIt == layerIt->end()) {
+        return {};
+    }
+    if (!mFile.seek(entryIt->offset)) {
+        return {};
+    }
+    const QByteArray rawData = mFile.read(entryIt->size);
+    if (rawData.size() != entryIt->size) {
+        qgvCritical() << "tile store" << getFileName() << "read error for" << tilePos;
+        layerIt->erase(entryIt);
+        return {};
+    }
+    entryIt->access = ++mAccessCounter;
+    return rawData;
+}
+
+bool QGVTileStore::open()
+{
+    if (!mFile.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    if (mFile.size() < fileHeaderSize) {
+        mFile.resize(0);
+        mFile.seek(0);
+        QDataStream stream(&mFile);
+        stream.setVersion(streamVersion);
+        stream << fileMagic << fileVersion;
+        mFile.flush();
+        return true;
+    }
+    if (!readIndex()) {
+        qgvCritical() << "tile store" << getFileName() << "has unsupported format and will be recreated";
+        mIndex.clear();
+        mFile.resize(0);
+        mFile.seek(0);
+        QDataStream stream(&mFile);
+        stream.setVersion(streamVersion);
+        stream << fileMagic << fileVersion;
+        mFile.flush();
+    }
+    return true;
+}
+
+bool QGVTileStore::readIndex()
+{
+    mFile.seek(0);
+    QDataStream stream(&mFile);
+    stream.setVersion(streamVersion);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != fileMagic || version != fileVersion) {
+        return false;
+    }
+
+    const qint64 fileSize = mFile.size();
+    while (!stream.atEnd()) {
+        const qint64 recordPos = mFile.pos();
+        QString layerId;
+        qint32 zoom = 0;
+        qint32 x = 0;
+        qint32 y = 0;
+        qint32 size = 0;
+        stream >> magic >> layerId >> zoom >> x >> y >> size;
+        const qint64 offset = mFile.pos();
+        if (stream.status() != QDataStream::Ok || magic != recordMagic || size <= 0 || offset + size > fileSize) {
+            qgvCritical() << "tile store" << getFileName() << "truncated at" << recordPos;
+            mFile.resize(recordPos);
+            break;
+        }
+        mFile.seek(offset + size);
+        mIndex[layerId][QGV::GeoTilePos(zoom, QPoint(x, y))] = Entry{ offset, size, ++mAccessCounter };
+    }
+    qgvDebug() << "tile store" << getFileName() << "opened with" << countEntries() << "tiles";
+    return true;
+}
+
+void QGVTileStore::compact(qint64 targetSize)
+{
+    if (!mFile.isOpen()) {
+        return;
+    }
+
+    struct Item
+    {
+        QString layerId;
+        QGV::GeoTilePos tilePos;
+        Entry entry;
+    };
+    QVector<Item> items;
+    items.reserve(countEntries());
+    for (auto layerIt = mIndex.cbegin(); layerIt != mIndex.cend(); ++layerIt) {
+        for (auto entryIt = layerIt->cbegin(); entryIt != layerIt->cend(); ++entryIt) {
+            items.append(Item{ layerIt.key(), entryIt.key(), entryIt.value() });
+        }
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.entry.access > b.entry.access; });
+
+    QFile packed(getFileName() + ".compact");
+    if (!packed.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qgvCritical() << "tile store" << getFileName() << "compaction failed:" << packed.errorString();
+        return;
+    }
+    QDataStream stream(&packed);
+    stream.setVersion(streamVersion);
+    stream << fileMagic << fileVersion;
+
+    QHash<QString, LayerIndex> index;
+    for (const Item& item : items) {
+        if (packed.size() + recordHeaderSize(item.layerId) + item.entry.size > targetSize) {
+            break;
+        }
+        mFile.seek(item.entry.offset);
+        const QByteArray rawData = mFile.read(item.entry.size);
+        Entry entry;
+        if (rawData.size() != item.entry.size || !writeRecord(packed, item.layerId, item.tilePos, rawData, entry)) {
+            continue;
+        }
+        entry.access = item.entry.access;
+        index[item.layerId][item.tilePos] = entry;
+    }
+    packed.close();
+    mFile.close();
+
+    /*
+     * Original pack is kept as backup until compacted one takes its name, so failed swap loses no tiles.
+     */
+    const QString backupName = getFileName() + ".backup";
+    QFile::remove(backupName);
+    if (!QFile::rename(getFileName(), backupName)) {
+        qgvCritical() << "tile store" << getFileName() << "compaction failed: original can't be moved to backup";
+        packed.remove();
+        if (!mFile.open(QIODevice::ReadWrite)) {
+            qgvCritical() << "tile store" << getFileName() << "can't be reopened:" << mFile.errorString();
+            mIndex.clear();
+        }
+        return;
+    }
+    if (!packed.rename(getFileName())) {
+        qgvCritical() << "tile store" << getFileName() << "compaction failed:" << packed.errorString();
+        packed.remove();
+        if (!QFile::rename(backupName, getFileName()) || !mFile.open(QIODevice::ReadWrite)) {
+            qgvCritical() << "tile store" << getFileName() << "can't be restored, original is kept in" << backupName;
+            mIndex.clear();
+        }
+        return;
+    }
+    QFile::remove(backupName);
+    mIndex = index;
+    if (!mFile.open(QIODevice::ReadWrite)) {
+        qgvCritical() << "tile store" << getFileName() << "can't be reopened:" << mFile.errorString();
+        mIndex.clear();
+        return;
+    }
+    qgvDebug() << "tile store" << getFileName() << "compacted to" << mFile.size() << "bytes";
+}
+
+bool QGVTileStore::writeRecord(QFile& file,
+                               const QString& layerId,
+                               const QGV::GeoTilePos& tilePos,
+                               const QByteArray& rawData,
+                               Entry& entry)
+{
+    QDataStream stream(&file);
+    stream.setVersion(streamVersion);
+    stream << recordMagic << layerId << static_cast<qint32>(tilePos.zoom()) << static_cast<qint32>(tilePos.pos().x())
+           << static_cast<qint32>(tilePos.pos().y()) << static_cast<qint32>(rawData.size());
+    entry.offset = file.pos();
+    entry.size = static_cast<qint32>(rawData.size());
+    return stream.status() == QDataStream::Ok && file.write(rawData) == rawData.size();
+}
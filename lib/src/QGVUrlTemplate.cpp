@@ -0,0 +1,188 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2024 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVUrlTemplate.h"
+
+QGVUrlTemplate::QGVUrlTemplate()
+    : mSubdomainIndex(-1)
+    , mLiteralSize(0)
+{
+}
+
+QGVUrlTemplate::QGVUrlTemplate(const QString& pattern, const QStringList& subdomains)
+    : mPattern(pattern)
+    , mSubdomains(subdomains)
+    , mSubdomainIndex(-1)
+    , mLiteralSize(0)
+{
+    compile();
+}
+
+void QGVUrlTemplate::setPattern(const QString& pattern)
+{
+    mPattern = pattern;
+    compile();
+}
+
+QString QGVUrlTemplate::getPattern() const
+{
+    return mPattern;
+}
+
+bool QGVUrlTemplate::isEmpty() const
+{
+    return mTokens.isEmpty();
+}
+
+void QGVUrlTemplate::setSubdomains(const QStringList& subdomains)
+{
+    mSubdomains = subdomains;
+}
+
+QStringList QGVUrlTemplate::getSubdomains() const
+{
+    return mSubdomains;
+}
+
+void QGVUrlTemplate::setSubdomainIndex(int index)
+{
+    mSubdomainIndex = index;
+}
+
+int QGVUrlTemplate::getSubdomainIndex() const
+{
+    return mSubdomainIndex;
+}
+
+void QGVUrlTemplate::setVariable(const QString& name, const QString& value)
+{
+    mVariables[name.toLower()] = value;
+}
+
+QString QGVUrlTemplate::getVariable(const QString& name) const
+{
+    return mVariables.value(name.toLower());
+}
+
+QString QGVUrlTemplate::format(const QGV::GeoTilePos& tilePos) const
+{
+    const int zoom = tilePos.zoom();
+    const int x = tilePos.pos().x();
+    const int y = tilePos.pos().y();
+
+    QString url;
+    url.reserve(mLiteralSize + 32);
+    for (const Token& token : mTokens) {
+        switch (token.type) {
+            case TokenType::Literal:
+                url.append(token.text);
+                break;
+            case TokenType::Zoom:
+                url.append(QString::number(zoom));
+                break;
+            case TokenType::X:
+                url.append(QString::number(x));
+                break;
+            case TokenType::Y:
+                url.append(QString::number(y));
+                break;
+            case TokenType::InvertedY:
+                url.append(QString::number((1 << zoom) - 1 - y));
+                break;
+            case TokenType::Subdomain:
+                if (!mSubdomains.isEmpty()) {
+                    const int count = mSubdomains.size();
+                    const int index = (mSubdomainIndex >= 0) ? qMin(mSubdomainIndex, count - 1) : (x + y) % count;
+                    url.append(mSubdomains.at(index));
+                }
+                break;
+            case TokenType::QuadKey:
+                for (int i = zoom; i > 0; i--) {
+                    const int mask = 1 << (i - 1);
+                    url.append(QChar('0' + (((x & mask) != 0) ? 1 : 0) + (((y & mask) != 0) ? 2 : 0)));
+                }
+                break;
+            case TokenType::BBox: {
+                const QGV::GeoRect rect = tilePos.toGeoRect();
+                url.append(QString::number(rect.lonLeft(), 'f', 6));
+                url.append(QLatin1Char(','));
+                url.append(QString::number(rect.latBottom(), 'f', 6));
+                url.append(QLatin1Char(','));
+                url.append(QString::number(rect.lonRigth(), 'f', 6));
+                url.append(QLatin1Char(','));
+                url.append(QString::number(rect.latTop(), 'f', 6));
+                break;
+            }
+            case TokenType::Variable:
+                url.append(mVariables.value(token.text));
+                break;
+        }
+    }
+    return url;
+}
+
+void QGVUrlTemplate::compile()
+{
+    mTokens.clear();
+    mLiteralSize = 0;
+
+    int pos = 0;
+    while (pos < mPattern.size()) {
+        const int open = mPattern.indexOf(QLatin1Char('{'), pos);
+        const int close = (open >= 0) ? mPattern.indexOf(QLatin1Char('}'), open + 1) : -1;
+        if (open < 0 || close < 0) {
+            appendLiteral(mPattern.mid(pos));
+            break;
+        }
+        const bool legacy = (open > pos && mPattern.at(open - 1) == QLatin1Char('$'));
+        const int start = (legacy) ? open - 1 : open;
+        appendLiteral(mPattern.mid(pos, start - pos));
+        appendPlaceholder(mPattern.mid(open + 1, close - open - 1).toLower());
+        pos = close + 1;
+    }
+}
+
+void QGVUrlTemplate::appendLiteral(const QString& text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+    mLiteralSize += text.size();
+    if (!mTokens.isEmpty() && mTokens.last().type == TokenType::Literal) {
+        mTokens.last().text.append(text);
+        return;
+    }
+    mTokens.append(Token{ TokenType::Literal, text });
+}
+
+void QGVUrlTemplate::appendPlaceholder(const QString& name)
+{
+    // clang-format off
+    static const QHash<QString, TokenType> types = {
+        { "z", TokenType::Zoom },
+        { "x", TokenType::X },
+        { "y", TokenType::Y },
+        { "-y", TokenType::InvertedY },
+        { "s", TokenType::Subdomain },
+        { "quadkey", TokenType::QuadKey },
+        { "qk", TokenType::QuadKey },
+        { "bbox", TokenType::BBox },
+    };
+    // clang-format on
+    mTokens.append(Token{ types.value(name, TokenType::Variable), name });
+}
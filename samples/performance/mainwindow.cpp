@@ -26,8 +26,8 @@
 #include <QVBoxLayout>
 
 #include <helpers.h>
-#include <rectangle.h>
 
+#include <QGeoView/QGVLayerBatch.h>
 #include <QGeoView/QGVLayerGoogle.h>
 #include <QGeoView/QGVWidgetCompass.h>
 
@@ -76,17 +76,19 @@ QGVLayer* MainWindow::create10000Layer() const
      * Layers will be owned by map.
      */
     auto target = target10000Area();
-    auto layer = new QGVLayer();
+    auto layer = new QGVLayerBatch();
     layer->setName("10000 elements");
     layer->setDescription("Demo for 10000 elements");
 
     /*
-     * Items will be owned by layer.
+     * Primitives are kept by batch layer and drawn by single scene item.
      */
     const int size = 20000;
+    layer->reservePrimitives(10000);
     for (int i = 0; i < 10000; i++) {
-        auto item = new Rectangle(Helpers::randRect(mMap, target, size), Qt::red);
-        layer->addItem(item);
+        const int index = layer->addPrimitive(QGVLayerBatch::Shape::Rectangle, Helpers::randRect(mMap, target, size),
+                                              Qt::red);
+        layer->setPrimitiveTooltip(index, QString("Rectangle %1").arg(index));
     }
 
     return layer;
@@ -120,6 +122,13 @@ QGroupBox* MainWindow::createOptionsList()
      * lead to high load on scene, especially when network had low latency and tiles from low levels are consistently
      * upscaled. VisibleZoomLayersBelowCurrent, VisibleZoomLayersAboveCurrent are limiting QGVLayerTiles to keep only
      * given number of zoom levels above or below current one. When is equals to 0 then only current level is allowed.
+     *
+     * MosaicRendering draws all tiles of one zoom level by single scene item without item cache. It reduces number of
+     * scene items and memory used by cached pixmaps.
+     *
+     * OverzoomFallback draws missing tiles of current level from cropped image of nearest loaded or cached tile
+     * below. Tiles below current level are not kept on scene in this mode, so VisibleZoomLayersBelowCurrent is ignored
+     * and gray areas are avoided without performance cost.
      */
 
     QGroupBox* groupBox = new QGroupBox(tr("Profiles"));
@@ -199,6 +208,35 @@ QGroupBox* MainWindow::createOptionsList()
         });
     }
 
+    {
+        /*
+         * Tile metrics are reset on every profile change, so profiles can be compared with same camera actions.
+         */
+        QLabel* metrics = new QLabel();
+        groupBox->layout()->addWidget(metrics);
+
+        mBackground->setMetricsInterval(1000);
+        connect(mBackground, &QGVLayerTiles::metricsUpdated, metrics, [metrics](const QGVTileMetrics& value) {
+            using Counter = QGVTileMetrics::Counter;
+            using Timing = QGVTileMetrics::Timing;
+            const auto& latency = value.getHistogram(Timing::NetworkLatency);
+            const auto& viewport = value.getHistogram(Timing::ViewportComplete);
+            metrics->setText(QString("Tiles requested %1, cancelled %2, failed %3, cache hits %4\n"
+                                     "Downloaded %5 KB, latency p50 %6 ms, p95 %7 ms\n"
+                                     "Decode p50 %8 ms, viewport complete p50 %9 ms, p95 %10 ms")
+                                     .arg(value.getCounter(Counter::Requested))
+                                     .arg(value.getCounter(Counter::Cancelled))
+                                     .arg(value.getCounter(Counter::Failed))
+                                     .arg(value.getCounter(Counter::CacheHits))
+                                     .arg(value.getCounter(Counter::BytesDownloaded) / 1024)
+                                     .arg(latency.getPercentile(50))
+                                     .arg(latency.getPercentile(95))
+                                     .arg(value.getHistogram(Timing::DecodeTime).getPercentile(50))
+                                     .arg(viewport.getPercentile(50))
+                                     .arg(viewport.getPercentile(95)));
+        });
+    }
+
     return groupBox;
 }
 
@@ -225,6 +263,9 @@ void MainWindow::setupProfileLook()
     mBackground->setVisibleZoomLayersBelowCurrent(10);
     mBackground->setVisibleZoomLayersAboveCurrent(10);
     mBackground->setCameraUpdatesDuringAnimation(true);
+    mBackground->setMosaicRendering(false);
+    mBackground->setOverzoomFallback(false);
+    mBackground->resetMetrics();
 }
 
 void MainWindow::setupProfileBalance()
@@ -235,6 +276,9 @@ void MainWindow::setupProfileBalance()
     mBackground->setVisibleZoomLayersBelowCurrent(1);
     mBackground->setVisibleZoomLayersAboveCurrent(3);
     mBackground->setCameraUpdatesDuringAnimation(true);
+    mBackground->setMosaicRendering(false);
+    mBackground->setOverzoomFallback(true);
+    mBackground->resetMetrics();
 }
 
 void MainWindow::setupProfileFast()
@@ -245,4 +289,7 @@ void MainWindow::setupProfileFast()
     mBackground->setVisibleZoomLayersBelowCurrent(1);
     mBackground->setVisibleZoomLayersAboveCurrent(1);
     mBackground->setCameraUpdatesDuringAnimation(false);
+    mBackground->setMosaicRendering(true);
+    mBackground->setOverzoomFallback(true);
+    mBackground->resetMetrics();
 }